@@ -12,1401 +12,7214 @@
 #include <memory>
 #include <array>
 #include <utility>
+#include <tuple>
+#include <iterator>
 #include <exception>
 #include <iostream>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <functional>
+#include <condition_variable>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+#if defined(__linux__)
+#include <sys/wait.h>
+#endif
+#if __cplusplus >= 201703L
+#include <optional>
+#endif
+#if __cplusplus > 201703L && defined(__has_include)
+#if __has_include(<ranges>)
+#include <ranges>
+#endif
+#endif
+
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define LINQ_EXCEPTIONS 1
+#else
+#define LINQ_EXCEPTIONS 0
+#endif
+
+#ifndef LINQ_THROW
+#if LINQ_EXCEPTIONS
+#define LINQ_THROW(message) throw ::LL::linq_exception(message)
+#else
+#define LINQ_THROW(message) ::LL::linq_fail(message)
+#endif
+#endif
+
+//exceptions of user functions are caught and rethrown only when exceptions are enabled
+#if LINQ_EXCEPTIONS
+#define LINQ_TRY try
+#define LINQ_CATCH_ALL catch (...)
+#else
+#define LINQ_TRY if (true)
+#define LINQ_CATCH_ALL else
+#endif
 
 namespace LL
 {
-	//excption
-	class linq_exception
+	//excption, operators throw string literals so a throw does not allocate
+	class linq_exception : public std::exception
 	{
 	private:
-		std::string message_;
+		std::shared_ptr<const std::string> owned_;
+		const char* message_;
 	public:
-		linq_exception() = default;
+		linq_exception() noexcept
+			:message_("")
+		{
+
+		}
+
+		//the message has to outlive the exception, like a string literal
+		linq_exception(const char* message) noexcept
+			:message_(message)
+		{
+
+		}
 
 		linq_exception(const std::string& message)
+			:owned_(std::make_shared<const std::string>(message)), message_(owned_->c_str())
 		{
-			message_ = message;
+
 		}
 
-		virtual const std::string& what() const noexcept
+		const char* what() const noexcept override
 		{
 			return message_;
 		}
 	};
 
+	//without exceptions a failing operator prints its message and aborts, define LINQ_THROW to handle it differently
+	[[noreturn]] inline void linq_fail(const char* message) noexcept
+	{
+		std::fputs(message, stderr);
+		std::fputc('\n', stderr);
+		std::abort();
+	}
+
 	template<typename TIterator>
 	using clean_type = typename std::remove_const<typename std::remove_reference<TIterator>::type>::type;
 
 
 	template<typename TIterator>
-	using value_type = decltype(**(TIterator*)0);
+	using value_type = decltype(*std::declval<TIterator&>());
 
-	namespace iterators
+	template<typename...>
+	struct make_void
 	{
-        //empty type
-        template<typename T>
-		class empty_iterator
+		typedef void type;
+	};
+
+	template<typename... Ts>
+	using void_t = typename make_void<Ts...>::type;
+
+	//random access source detection, LINQ iterators have no iterator_traits
+	template<typename TIterator, typename = void>
+	struct is_random_access : std::false_type {};
+
+	template<typename TIterator>
+	struct is_random_access<TIterator, void_t<typename std::iterator_traits<TIterator>::iterator_category>>
+		: std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<TIterator>::iterator_category> {};
+
+	template<typename TIterator, typename = void>
+	struct is_forward_lvalue : std::false_type {};
+
+	template<typename TIterator>
+	struct is_forward_lvalue<TIterator, void_t<typename std::iterator_traits<TIterator>::iterator_category>>
+		: std::integral_constant<bool, std::is_lvalue_reference<typename std::iterator_traits<TIterator>::reference>::value
+			&& std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<TIterator>::iterator_category>::value> {};
+
+	//sources whose elements live outside the query, first, last, single and element_at return references into them
+	//adapters that pass the elements of such a source through specialize it below, results the query owns never do
+	template<typename TIterator>
+	struct stable_reference : is_forward_lvalue<TIterator> {};
+
+	//contiguous sources of trivially copyable values are written without a copy per element
+	template<typename TIterator>
+	struct is_contiguous : std::integral_constant<bool, std::is_pointer<TIterator>::value
+		|| (std::is_same<TIterator, typename std::vector<clean_type<value_type<TIterator>>>::const_iterator>::value && !std::is_same<clean_type<value_type<TIterator>>, bool>::value)
+		|| (std::is_same<TIterator, typename std::vector<clean_type<value_type<TIterator>>>::iterator>::value && !std::is_same<clean_type<value_type<TIterator>>, bool>::value)
+#ifdef __cpp_lib_ranges
+		|| std::contiguous_iterator<TIterator>
+#endif
+		> {};
+
+	//every Queryable is a std::ranges::view when the standard library has ranges
+#ifdef __cpp_lib_ranges
+	struct queryable_base : std::ranges::view_base {};
+#else
+	struct queryable_base {};
+#endif
+
+	template<typename TIterator>
+	class Queryable;
+
+	template<typename TIterator, typename TComparer>
+	class OrderedQueryable;
+
+	template<typename TIterator, typename TComparer>
+	class SortedQueryable;
+
+	template<typename TKey, typename TElement>
+	class hash_index;
+
+	template<typename TKey, typename TElement>
+	class sorted_index;
+
+	namespace execution
+	{
+		struct sequenced_policy
 		{
-			typedef empty_iterator<T> TSelf;
-		public:
-			empty_iterator() = default;
+		};
 
-			TSelf& operator++()
+		struct parallel_policy
+		{
+			//0 uses every hardware thread
+			size_t concurrency;
+			//operators whose parallel output order differs from the serial one restore it
+			bool preserve_order;
+
+			constexpr parallel_policy with_concurrency(size_t n) const
 			{
-				return *this;
+				return parallel_policy{ n, preserve_order };
 			}
 
-			TSelf operator++(int)
+			constexpr parallel_policy ordered() const
 			{
-				return *this;
+				return parallel_policy{ concurrency, true };
 			}
+		};
 
-			T operator*()const
+		constexpr sequenced_policy seq{};
+		constexpr parallel_policy par{ 0, false };
+	}
+
+	namespace parallel
+	{
+		inline size_t concurrency(const execution::parallel_policy& policy)
+		{
+			if (policy.concurrency != 0) return policy.concurrency;
+			size_t n = std::thread::hardware_concurrency();
+			return n == 0 ? 1 : n;
+		}
+
+		//work stealing pool, a worker runs the newest task of its own deque and steals the oldest task of a random victim
+		//tasks submitted from a worker go to its own deque, so nested parallel queries run on the same threads
+		class thread_pool
+		{
+		private:
+			struct worker_queue
 			{
-				throw linq_exception("Failed to get a value from an empty collection.");
-			}
+				std::mutex mutex;
+				std::deque<std::function<void()>> tasks;
+			};
 
-			bool operator==(const TSelf& it)const
+			std::vector<std::unique_ptr<worker_queue>> queues_;
+			std::vector<std::thread> threads_;
+			std::mutex sleep_mutex_;
+			std::condition_variable wake_;
+			std::atomic<size_t> queued_;
+			bool stopping_;
+
+			//the pool and worker index of the calling thread
+			static std::pair<const thread_pool*, size_t>& current()
 			{
-				return true;
+				thread_local std::pair<const thread_pool*, size_t> worker(nullptr, 0);
+				return worker;
 			}
 
-			bool operator!=(const TSelf& it)const
+			static size_t random(size_t n)
 			{
-				return false;
+				thread_local std::minstd_rand engine(static_cast<unsigned>(std::hash<std::thread::id>()(std::this_thread::get_id())));
+				return static_cast<size_t>(engine()) % n;
 			}
-		};
-        //any type 
-        template<typename T>
-        class any_type_iterator
-        {
-            private:
-                class iterator_holder_base
-                {
-                    typedef iterator_holder_base TSelf;
-                    public:
-                        virtual std::shared_ptr<TSelf> next() = 0;
-                        virtual T deref() = 0;
-                        virtual bool equals(const std::shared_ptr<TSelf>& p) = 0;
-                };
-
-                template<typename TIterator>
-                class iterator_holder_impl : public iterator_holder_base
-                {
-                    typedef iterator_holder_impl<TIterator> TSelf;
-                    private:
-                        TIterator iter_;
-                    public:
-                        iterator_holder_impl(const TIterator &iter)
-                        {
-                            iter_ = iter;
-                        }
-                        std::shared_ptr<iterator_holder_base> next()
-                        {
-                            auto t = iter_;
-                            ++t;
-                            return std::make_shared<TSelf>(t);
-                        }
-                        T deref()
-                        {
-                            return *iter_;
-                        }
-                        bool equals(const std::shared_ptr<iterator_holder_base>& p)
-                        {
-                            auto impl = std::dynamic_pointer_cast<TSelf>(p);
-                            return impl && (iter_ == impl->iter_);
-                        }
-                };
-                typedef any_type_iterator<T> TSelf;
-                std::shared_ptr<iterator_holder_base> iterator_;
-            public:
-                any_type_iterator() = default;
-                template<typename TIterator>
-                any_type_iterator(const TIterator& iter):
-                        iterator_(std::make_shared<iterator_holder_impl<TIterator>>(iter))
-                {
-                }
-                TSelf& operator++()
-                {
-                    iterator_ = iterator_->next();
-                    return *this;
-                }
-
-                TSelf operator++(int)
-                {
-                    TSelf t = *this;
-                    iterator_ = iterator_->next();
-                    return t;
-                }
-
-                T operator*()const
-                {
-                    return iterator_->deref();
-                }
 
-                bool operator==(const TSelf& it)const
-                {
-                    return iterator_->equals(it.iterator_);
-                }
-
-                bool operator!=(const TSelf& it)const
-                {
-                    return !(iterator_->equals(it.iterator_));
-                }
-        };
-		//filter, mutate
-		template<typename TIterator, typename TPredict>
-		class where_iterator
-		{
-			typedef where_iterator<TIterator, TPredict> TSelf;
-		private:
-			TIterator current_;
-			TIterator end_;
-			TPredict func_;
+			bool take(worker_queue& queue, bool newest, std::function<void()>& task)
+			{
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				if (queue.tasks.empty()) return false;
+				if (newest)
+				{
+					task = std::move(queue.tasks.back());
+					queue.tasks.pop_back();
+				}
+				else
+				{
+					task = std::move(queue.tasks.front());
+					queue.tasks.pop_front();
+				}
+				--queued_;
+				return true;
+			}
 
+			void work(size_t index)
+			{
+				current() = std::make_pair(this, index);
+				for (;;)
+				{
+					if (run_one()) continue;
+					std::unique_lock<std::mutex> lock(sleep_mutex_);
+					wake_.wait(lock, [this]() { return stopping_ || queued_ != 0; });
+					if (stopping_ && queued_ == 0) return;
+				}
+			}
 		public:
-			where_iterator() = default;
-			where_iterator(const TIterator& current, const TIterator& end, const TPredict& func)
-				:current_(current), end_(end), func_(func)
+			//0 starts one worker less than the hardware threads, the thread waiting on a task_group runs tasks too
+			explicit thread_pool(size_t threads = 0)
+				:queued_(0), stopping_(false)
 			{
-				while (current_ != end_ && !func_(*current_))
+				if (threads == 0)
 				{
-					++current_;
+					size_t hardware = std::thread::hardware_concurrency();
+					threads = hardware > 1 ? hardware - 1 : 1;
+				}
+				for (size_t i = 0; i < threads; ++i)
+				{
+					queues_.emplace_back(new worker_queue());
+				}
+				for (size_t i = 0; i < threads; ++i)
+				{
+					threads_.emplace_back(&thread_pool::work, this, i);
 				}
 			}
 
-			TSelf& operator++()
+			thread_pool(const thread_pool&) = delete;
+			thread_pool& operator=(const thread_pool&) = delete;
+
+			//queued tasks are run before the workers stop
+			~thread_pool()
 			{
-				while (current_ != end_)
 				{
-					++current_;
-					if (current_ == end_) break;
-					if (func_(*current_)) break;
+					std::lock_guard<std::mutex> lock(sleep_mutex_);
+					stopping_ = true;
+				}
+				wake_.notify_all();
+				for (auto& thread : threads_)
+				{
+					thread.join();
 				}
-				return *this;
 			}
 
-			const TSelf operator++(int)
+			size_t size() const
 			{
-				TSelf self = *this;
-				while (current_ != end_)
+				return threads_.size();
+			}
+
+			void submit(std::function<void()> task)
+			{
+				auto& worker = current();
+				size_t index = worker.first == this ? worker.second : random(queues_.size());
 				{
-					++current_;
-					if (current_ == end_) break;
-					if (func_(*current_)) break;
+					std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+					queues_[index]->tasks.push_back(std::move(task));
+					++queued_;
 				}
-				return self;
+				{
+					std::lock_guard<std::mutex> lock(sleep_mutex_);
+				}
+				wake_.notify_one();
 			}
 
-			auto operator*() const -> decltype(*current_)
+			//runs one queued task on the calling thread, a worker tries its own deque first, false when there was none
+			bool run_one()
 			{
-				return *current_;
+				auto& worker = current();
+				bool own = worker.first == this;
+				std::function<void()> task;
+				if (own && take(*queues_[worker.second], true, task))
+				{
+					task();
+					return true;
+				}
+				size_t start = random(queues_.size());
+				for (size_t i = 0; i < queues_.size(); ++i)
+				{
+					size_t victim = (start + i) % queues_.size();
+					if (own && victim == worker.second) continue;
+					if (take(*queues_[victim], false, task))
+					{
+						task();
+						return true;
+					}
+				}
+				return false;
 			}
 
-			bool operator==(const TSelf& iter) const
+			//blocks the calling thread until done() holds or a task is queued, whoever makes done() true calls notify_all
+			template<typename TDone>
+			void wait_for(const TDone& done)
 			{
-				return current_ == iter.current_;
+				std::unique_lock<std::mutex> lock(sleep_mutex_);
+				wake_.wait(lock, [&]() { return done() || queued_ != 0; });
 			}
 
-			bool operator!=(const TSelf& iter) const
+			void notify_all()
 			{
-				return current_ != iter.current_;
+				{
+					std::lock_guard<std::mutex> lock(sleep_mutex_);
+				}
+				wake_.notify_all();
 			}
 		};
 
+		struct pool_settings
+		{
+			std::mutex mutex;
+			bool started = false;
+			size_t threads = 0;
+		};
 
-		template<typename TIterator, typename TPredict>
-		class select_iterator
+		inline pool_settings& default_pool_settings()
 		{
-			typedef select_iterator<TIterator, TPredict> TSelf;
-		private:
-			TIterator current_;
-			TIterator end_;
-			TPredict func_;
-		public:
-			select_iterator() = default;
-			select_iterator(const TIterator& current, const TIterator& end, const TPredict& func)
-				:current_(current), end_(end), func_(func)
+			static pool_settings settings;
+			return settings;
+		}
+
+		//the pool every parallel operator runs on, share it with other tasks through task_group
+		inline thread_pool& default_pool()
+		{
+			static thread_pool pool([]()
 			{
+				auto& settings = default_pool_settings();
+				std::lock_guard<std::mutex> lock(settings.mutex);
+				settings.started = true;
+				return settings.threads;
+			}());
+			return pool;
+		}
 
-			}
+		//worker count of default_pool, only before its first use
+		inline void set_default_pool_size(size_t threads)
+		{
+			auto& settings = default_pool_settings();
+			std::lock_guard<std::mutex> lock(settings.mutex);
+			if (settings.started) LINQ_THROW("The default pool is already running.");
+			settings.threads = threads;
+		}
 
-			TSelf& operator++()
-			{
-				++current_;
-				return *this;
-			}
+		//tasks run on a pool, wait() runs queued tasks on the calling thread until every task of the group finished
+		class task_group
+		{
+		private:
+			thread_pool& pool_;
+			std::atomic<size_t> pending_;
+			std::mutex error_mutex_;
+			std::exception_ptr error_;
 
-			const TSelf operator++(int)
+			//helps with queued tasks and sleeps while there are none
+			void join()
 			{
-				TSelf self = *this;
-				++current_;
-				return self;
+				while (pending_ != 0)
+				{
+					if (!pool_.run_one()) pool_.wait_for([this]() { return pending_ == 0; });
+				}
 			}
-
-			auto operator*() const -> decltype(func_(*current_))
+		public:
+			explicit task_group(thread_pool& pool = default_pool())
+				:pool_(pool), pending_(0)
 			{
-				return func_(*current_);
-			}
 
-			bool operator==(const TSelf& iter) const
-			{
-				return current_ == iter.current_;
 			}
 
-			bool operator!=(const TSelf& iter) const
+			task_group(const task_group&) = delete;
+			task_group& operator=(const task_group&) = delete;
+
+			~task_group()
 			{
-				return current_ != iter.current_;
+				join();
 			}
-		};
 
-		//single with parameter
-		template<typename TIterator, typename TPredict>
-		class single_iterator
-		{
-			typedef single_iterator<TIterator, TPredict> TSelf;
-		private:
-			TIterator current_;
-			TIterator end_;
-			TPredict func_;
-			TIterator single_;
-		public:
-			single_iterator() = default;
-			single_iterator(const TIterator& current, const TIterator& end, const TPredict& func)
-				:current_(current), end_(end), func_(func), single_(current_)
+			template<typename TFunc>
+			void run(const TFunc& func)
 			{
-				for (auto it = current_; it != end_; ++it)
+				++pending_;
+				pool_.submit([this, func]()
 				{
-					if (func_(*it))
+					LINQ_TRY
 					{
-						single_ = it;
+						func();
 					}
-				}
+					LINQ_CATCH_ALL
+					{
+						std::lock_guard<std::mutex> lock(error_mutex_);
+						if (!error_) error_ = std::current_exception();
+					}
+					//the group may be gone once pending_ is 0
+					thread_pool& pool = pool_;
+					if (--pending_ == 0) pool.notify_all();
+				});
 			}
 
-			TSelf& operator++()
+			//rethrows the first exception of a task
+			void wait()
 			{
-				current_ = end_;
-				return *this;
+				join();
+				std::exception_ptr error;
+				std::swap(error, error_);
+				if (error) std::rethrow_exception(error);
 			}
+		};
 
-			const TSelf operator++(int)
+		//splits [0, size) into contiguous blocks and calls func(block, first, last) for each block as a task of default_pool,
+		//the calling thread runs block 0 and then helps until every block is done
+		template<typename TFunc>
+		void for_each_block(size_t size, size_t blocks, const TFunc& func)
+		{
+			if (blocks > size) blocks = size;
+			if (blocks == 0) return;
+			if (blocks == 1)
 			{
-				TSelf self = *this;
-				current_ = end_;
-				return self;
+				func(0, 0, size);
+				return;
 			}
-
-			auto operator*() const -> decltype(*single_)
+			std::vector<std::exception_ptr> errors(blocks);
+			auto run = [&](size_t block)
 			{
-				return *single_;
-			}
-
-			bool operator==(const TSelf& iter) const
+				LINQ_TRY
+				{
+					func(block, size * block / blocks, size * (block + 1) / blocks);
+				}
+				LINQ_CATCH_ALL
+				{
+					errors[block] = std::current_exception();
+				}
+			};
 			{
-				return current_ == iter.current_;
+				task_group group;
+				for (size_t block = 1; block < blocks; ++block)
+				{
+					group.run([&run, block]() { run(block); });
+				}
+				run(0);
+				group.wait();
 			}
-
-			bool operator!=(const TSelf& iter) const
+			for (auto& error : errors)
 			{
-				return current_ != iter.current_;
+				if (error) std::rethrow_exception(error);
 			}
-		};
-		//skip, take
-		template<typename TIterator>
-		class skip_iterator
+		}
+
+		//calls func(task) for every task in [0, tasks) on at most concurrency threads, each takes the next task when it finishes one
+		template<typename TFunc>
+		void for_each_task(size_t tasks, size_t concurrency, const TFunc& func)
 		{
-			typedef skip_iterator<TIterator> TSelf;
-		private:
-			TIterator current_;
-			TIterator end_;
-		public:
-			skip_iterator() = default;
-			skip_iterator(const TIterator& current, const TIterator& end, int skip_count)
-				:current_(current), end_(end)
+			std::atomic<size_t> next(0);
+			size_t runners = std::min(tasks, std::max<size_t>(1, concurrency));
+			for_each_block(runners, runners, [&](size_t, size_t, size_t)
 			{
-				while (skip_count > 0 && current_ != end_)
+				for (size_t task = next++; task < tasks; task = next++)
 				{
-					--skip_count;
-					++current_;
+					func(task);
 				}
-			}
+			});
+		}
 
-			TSelf& operator++()
+		//sorts blocks concurrently, then merges neighbouring blocks pairwise, stable
+		template<typename TElement, typename TComparer>
+		void stable_sort(std::vector<TElement>& v, const TComparer& comparer, size_t concurrency)
+		{
+			const size_t min_block_size = 1 << 13;
+			size_t blocks = std::min(concurrency, v.size() / min_block_size);
+			if (blocks < 2)
 			{
-				++current_;
-				return *this;
+				std::stable_sort(v.begin(), v.end(), comparer);
+				return;
 			}
-
-			const TSelf operator++(int)
+			std::vector<size_t> bounds(blocks + 1);
+			for (size_t i = 0; i <= blocks; ++i)
 			{
-				TSelf self = *this;
-				++current_;
-				return self;
+				bounds[i] = v.size() * i / blocks;
 			}
-
-			auto operator*() const -> decltype(*current_)
+			for_each_block(blocks, blocks, [&](size_t, size_t first, size_t last)
 			{
-				return *current_;
+				for (size_t b = first; b < last; ++b)
+				{
+					std::stable_sort(v.begin() + bounds[b], v.begin() + bounds[b + 1], comparer);
+				}
+			});
+			for (size_t width = 1; width < blocks; width *= 2)
+			{
+				size_t merges = (blocks + 2 * width - 1) / (2 * width);
+				for_each_block(merges, merges, [&](size_t, size_t first, size_t last)
+				{
+					for (size_t m = first; m < last; ++m)
+					{
+						size_t lo = m * 2 * width;
+						size_t mid = std::min(lo + width, blocks);
+						size_t hi = std::min(lo + 2 * width, blocks);
+						if (mid < hi)
+						{
+							std::inplace_merge(v.begin() + bounds[lo], v.begin() + bounds[mid], v.begin() + bounds[hi], comparer);
+						}
+					}
+				});
 			}
+		}
+	}
 
-			bool operator==(const TSelf& iter) const
+	namespace parallel
+	{
+		//two pass prefix scan, func should be associative and elements convertible to TAccumulate
+		template<typename TRandomIterator, typename TAccumulate, typename TPredict>
+		std::vector<TAccumulate> inclusive_scan(TRandomIterator first, TRandomIterator last, const TAccumulate& init, const TPredict& func, size_t concurrency)
+		{
+			const size_t min_block_size = 1 << 13;
+			size_t size = static_cast<size_t>(last - first);
+			size_t blocks = std::min(concurrency, size / min_block_size);
+			std::vector<TAccumulate> result(size, init);
+			if (blocks < 2)
 			{
-				return current_ == iter.current_;
+				auto accumulate = init;
+				for (size_t i = 0; i < size; ++i)
+				{
+					accumulate = func(accumulate, first[i]);
+					result[i] = accumulate;
+				}
+				return result;
 			}
-
-			bool operator!=(const TSelf& iter) const
+			//local scan of every block
+			for_each_block(size, blocks, [&](size_t, size_t lo, size_t hi)
 			{
-				return current_ != iter.current_;
+				TAccumulate accumulate = first[lo];
+				result[lo] = accumulate;
+				for (size_t i = lo + 1; i < hi; ++i)
+				{
+					accumulate = func(accumulate, first[i]);
+					result[i] = accumulate;
+				}
+			});
+			//carry of every block
+			std::vector<TAccumulate> offsets(blocks, init);
+			for (size_t b = 1; b < blocks; ++b)
+			{
+				offsets[b] = func(offsets[b - 1], result[size * b / blocks - 1]);
 			}
-		};
+			for_each_block(size, blocks, [&](size_t b, size_t lo, size_t hi)
+			{
+				for (size_t i = lo; i < hi; ++i)
+				{
+					result[i] = func(offsets[b], result[i]);
+				}
+			});
+			return result;
+		}
 
-		template<typename TIterator, typename TPredict>
-		class skip_while_iterator
+		//number of blocks for size elements, small inputs stay on the calling thread
+		inline size_t blocks_for(size_t size, size_t concurrency)
 		{
-			typedef skip_while_iterator<TIterator, TPredict> TSelf;
-		private:
-			TIterator current_;
-			TIterator end_;
-			TPredict func_;
+			const size_t min_block_size = 1 << 13;
+			return std::max<size_t>(1, std::min(concurrency, size / min_block_size));
+		}
 
-		public:
-			skip_while_iterator() = default;
-			skip_while_iterator(const TIterator& current, const TIterator& end, const TPredict& func)
-				:current_(current), end_(end), func_(func)
+		//enough partitions that the build side of each one stays in cache
+		inline size_t partitions_for(size_t build_size, size_t blocks)
+		{
+			const size_t partition_size = 1 << 12;
+			const size_t max_partitions = 1 << 10;
+			return std::max(blocks, std::min(max_partitions, build_size / partition_size));
+		}
+
+		//std::hash of integers is the identity, so keys with a common stride would share a partition without the mix
+		inline size_t partition_of(size_t hash, size_t partitions)
+		{
+			std::uint64_t h = static_cast<std::uint64_t>(hash) * 0x9E3779B97F4A7C15ull;
+			h ^= h >> 29;
+			return static_cast<size_t>(((h >> 32) * partitions) >> 32);
+		}
+
+		//scatters (key, index) of [0, size) into lists[block][partition] by key hash, each list keeps the source order
+		template<typename TKey, typename TKeyOf>
+		std::vector<std::vector<std::vector<std::pair<TKey, size_t>>>> partition_by_key(size_t size, size_t blocks, size_t partitions, const TKeyOf& key_of)
+		{
+			std::vector<std::vector<std::vector<std::pair<TKey, size_t>>>> lists(blocks, std::vector<std::vector<std::pair<TKey, size_t>>>(partitions));
+			for_each_block(size, blocks, [&](size_t block, size_t lo, size_t hi)
 			{
-				while (current_ != end_ && func_(*current_) )
+				std::hash<TKey> hash;
+				for (size_t i = lo; i < hi; ++i)
 				{
-					++current_;
+					TKey key = key_of(i);
+					size_t partition = partition_of(hash(key), partitions);
+					lists[block][partition].emplace_back(std::move(key), i);
 				}
-			}
+			});
+			return lists;
+		}
 
-			TSelf& operator++()
+		//joins the per partition outputs, an ordered policy sorts them by key keeping the order inside a key
+		template<typename TPair>
+		std::vector<TPair> concat(std::vector<std::vector<TPair>>& outputs, const execution::parallel_policy& policy, size_t concurrency)
+		{
+			std::vector<TPair> result;
+			for (auto& output : outputs)
 			{
-				++current_;
-				return *this;
+				std::move(output.begin(), output.end(), std::back_inserter(result));
 			}
-
-			const TSelf operator++(int)
+			if (policy.preserve_order)
 			{
-				TSelf self = *this;
-				++current_;
-				return self;
+				stable_sort(result, [](const TPair& a, const TPair& b){return a.first < b.first; }, concurrency);
 			}
+			return result;
+		}
+	}
 
-			auto operator*() const -> decltype(*current_)
+	//result of join and group_join, the key with the matched outer and inner values
+	template<typename TKey, typename TFirst, typename TSecond>
+	using join_pair = std::pair<TKey, std::pair<TFirst, TSecond>>;
+
+	//order_by and the other buffering operators spill to files once their buffers reach this size
+	struct memory_budget
+	{
+		//approximate, every buffered element counts sizeof(TElement)
+		size_t bytes;
+		//empty uses TMPDIR, TMP, TEMP or /tmp
+		std::string temp_directory = std::string();
+	};
+
+	//observed by except, intersect and join when they prefilter with a bloom_filter
+	struct bloom_filter_statistics
+	{
+		//elements or keys looked up
+		size_t probes;
+		//lookups the filter answered without the table
+		size_t rejected;
+		//lookups found in the table
+		size_t matches;
+
+		//share of the lookups missing from the table that still passed the filter
+		double false_positive_rate() const
+		{
+			size_t misses = probes - matches;
+			return misses == 0 ? 0.0 : static_cast<double>(misses - rejected) / static_cast<double>(misses);
+		}
+	};
+
+	struct bloom_filter_options
+	{
+		//about 1% false positives at 10 bits per distinct build side key
+		double bits_per_key = 10;
+		//written when the operator has run
+		bloom_filter_statistics* statistics = nullptr;
+	};
+
+	//split block bloom filter, a key sets one bit in each of the eight 32 bit words of one 256 bit block
+	//a lookup reads a single cache line and its eight lanes are independent, so the loops vectorize
+	class bloom_filter
+	{
+	private:
+		static const size_t lanes = 8;
+
+		std::vector<std::uint32_t> words_;
+		std::uint64_t blocks_;
+
+		//std::hash of integers is the identity
+		static std::uint64_t mix(size_t hash)
+		{
+			std::uint64_t h = static_cast<std::uint64_t>(hash) * 0x9E3779B97F4A7C15ull;
+			return h ^ (h >> 29);
+		}
+
+		//first word of the block of h
+		size_t offset(std::uint64_t h) const
+		{
+			return static_cast<size_t>(((h >> 32) * blocks_) >> 32) * lanes;
+		}
+
+		static void masks(std::uint64_t h, std::uint32_t (&mask)[lanes])
+		{
+			static const std::uint32_t salts[lanes] = { 0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du, 0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u };
+			std::uint32_t key = static_cast<std::uint32_t>(h);
+			for (size_t i = 0; i < lanes; ++i)
 			{
-				return *current_;
+				mask[i] = std::uint32_t(1) << ((key * salts[i]) >> 27);
 			}
+		}
+	public:
+		bloom_filter(size_t keys, double bits_per_key)
+		{
+			double bits = std::max(1.0, static_cast<double>(keys) * bits_per_key);
+			blocks_ = static_cast<std::uint64_t>(std::ceil(bits / (32 * lanes)));
+			if (blocks_ >= (std::uint64_t(1) << 32)) LINQ_THROW("Too many keys for a bloom filter.");
+			words_.assign(static_cast<size_t>(blocks_) * lanes, 0);
+		}
 
-			bool operator==(const TSelf& iter) const
+		void insert(size_t hash)
+		{
+			std::uint64_t h = mix(hash);
+			std::uint32_t mask[lanes];
+			masks(h, mask);
+			std::uint32_t* words = words_.data() + offset(h);
+			for (size_t i = 0; i < lanes; ++i)
 			{
-				return current_ == iter.current_;
+				words[i] |= mask[i];
 			}
+		}
 
-			bool operator!=(const TSelf& iter) const
+		bool may_contain(size_t hash) const
+		{
+			std::uint64_t h = mix(hash);
+			std::uint32_t mask[lanes];
+			masks(h, mask);
+			const std::uint32_t* words = words_.data() + offset(h);
+			std::uint32_t missing = 0;
+			for (size_t i = 0; i < lanes; ++i)
 			{
-				return current_ != iter.current_;
+				missing |= mask[i] & ~words[i];
 			}
-		};
+			return missing == 0;
+		}
 
-		template<typename TIterator>
-		class take_iterator
+		size_t bits() const
 		{
-			typedef take_iterator<TIterator> TSelf;
-		private:
-			TIterator current_;
-			TIterator end_;
-			int count_;
-			int cur_count_;
-		public:
-			take_iterator() = default;
-			take_iterator(const TIterator& current, const TIterator& end, int take_count)
-				:current_(current), end_(end), count_(take_count), cur_count_(0)
+			return words_.size() * 32;
+		}
+	};
+
+	//binary format of spilled and exported elements, specialize it for other types with the same write and read
+	//streams have write(const void* data, size_t size) and bool read(void* data, size_t size)
+	template<typename T, typename = void>
+	struct serializer;
+
+	template<typename T>
+	struct serializer<T, typename std::enable_if<std::is_trivially_copyable<T>::value>::type>
+	{
+		template<typename TStream>
+		static void write(TStream& stream, const T& value)
+		{
+			stream.write(&value, sizeof(T));
+		}
+
+		template<typename TStream>
+		static bool read(TStream& stream, T& value)
+		{
+			return stream.read(&value, sizeof(T));
+		}
+	};
+
+	template<typename TChar, typename TTraits, typename TAlloc>
+	struct serializer<std::basic_string<TChar, TTraits, TAlloc>, void>
+	{
+		template<typename TStream>
+		static void write(TStream& stream, const std::basic_string<TChar, TTraits, TAlloc>& value)
+		{
+			serializer<size_t>::write(stream, value.size());
+			stream.write(value.data(), value.size() * sizeof(TChar));
+		}
+
+		template<typename TStream>
+		static bool read(TStream& stream, std::basic_string<TChar, TTraits, TAlloc>& value)
+		{
+			size_t size;
+			if (!serializer<size_t>::read(stream, size)) return false;
+			value.resize(size);
+			return stream.read(&value[0], size * sizeof(TChar));
+		}
+	};
+
+	template<typename T, typename TAlloc>
+	struct serializer<std::vector<T, TAlloc>, void>
+	{
+		template<typename TStream>
+		static void write(TStream& stream, const std::vector<T, TAlloc>& value)
+		{
+			serializer<size_t>::write(stream, value.size());
+			for (auto& element : value)
 			{
-				if (cur_count_ == count_)
-				{
-					current_ = end_;
-				}
+				serializer<T>::write(stream, element);
 			}
+		}
 
-			TSelf& operator++()
+		template<typename TStream>
+		static bool read(TStream& stream, std::vector<T, TAlloc>& value)
+		{
+			size_t size;
+			if (!serializer<size_t>::read(stream, size)) return false;
+			value.resize(size);
+			for (auto& element : value)
 			{
-				if(++cur_count_ == count_)
-				{
-					current_ = end_;
-				}
-				else if(current_ != end_)
-				{
-					++current_;
-				}
-				return *this;
+				if (!serializer<T>::read(stream, element)) return false;
 			}
+			return true;
+		}
+	};
+
+	template<typename T1, typename T2>
+	struct serializer<std::pair<T1, T2>, typename std::enable_if<!std::is_trivially_copyable<std::pair<T1, T2>>::value>::type>
+	{
+		template<typename TStream>
+		static void write(TStream& stream, const std::pair<T1, T2>& value)
+		{
+			serializer<clean_type<T1>>::write(stream, value.first);
+			serializer<clean_type<T2>>::write(stream, value.second);
+		}
+
+		template<typename TStream>
+		static bool read(TStream& stream, std::pair<T1, T2>& value)
+		{
+			return serializer<clean_type<T1>>::read(stream, value.first) && serializer<clean_type<T2>>::read(stream, value.second);
+		}
+	};
 
-			const TSelf operator++(int)
+	namespace spill
+	{
+		inline std::string temp_directory(const memory_budget& budget)
+		{
+			if (!budget.temp_directory.empty()) return budget.temp_directory;
+			for (const char* name : { "TMPDIR", "TMP", "TEMP" })
 			{
-				TSelf self = *this;
-				if (++cur_count_ == count_)
-				{
-					current_ = end_;
-				}
-				else if(current_ != end_)
-				{
-					++current_;
-				}
-				return self;
+				const char* directory = std::getenv(name);
+				if (directory != nullptr && *directory != '\0') return directory;
 			}
+			return "/tmp";
+		}
 
-			auto operator*() const -> decltype(*current_)
+		//a temp file removed by its destructor, names are unique per process and per file
+		class spill_file
+		{
+		private:
+			std::string path_;
+		public:
+			explicit spill_file(const memory_budget& budget)
 			{
-				return *current_;
+				static const unsigned long long process = std::random_device()() ^ static_cast<unsigned long long>(std::chrono::steady_clock::now().time_since_epoch().count());
+				static std::atomic<unsigned long long> counter(0);
+				path_ = temp_directory(budget) + "/cpplinq-" + std::to_string(process) + "-" + std::to_string(counter++) + ".spill";
 			}
 
-			bool operator==(const TSelf& iter) const
+			spill_file(const spill_file&) = delete;
+			spill_file& operator=(const spill_file&) = delete;
+
+			~spill_file()
 			{
-				return current_ == iter.current_;
+				std::remove(path_.c_str());
 			}
 
-			bool operator!=(const TSelf& iter) const
+			const std::string& path() const
 			{
-				return current_ != iter.current_;
+				return path_;
 			}
 		};
 
-		template<typename TIterator, typename TPredict>
-		class take_while_iterator
+		//buffered sequential access to a spill file through serializer<T>
+		template<typename T>
+		class file_stream
 		{
-			typedef take_while_iterator<TIterator, TPredict> TSelf;
 		private:
-			TIterator current_;
-			TIterator end_;
-			TPredict func_;
-
+			std::unique_ptr<std::FILE, int(*)(std::FILE*)> file_;
+			std::vector<char> buffer_;
 		public:
-			take_while_iterator() = default;
-			take_while_iterator(const TIterator& current, const TIterator& end, const TPredict& func)
-				:current_(current), end_(end), func_(func)
+			file_stream(const spill_file& file, const char* mode)
+				:file_(std::fopen(file.path().c_str(), mode), &std::fclose), buffer_(1 << 16)
 			{
-				if (current_ != end_ && !func_(*current_))
+				if (!file_)
 				{
-					current_ = end_;
+					LINQ_THROW("Failed to open a spill file.");
 				}
+				std::setvbuf(file_.get(), buffer_.data(), _IOFBF, buffer_.size());
 			}
 
-			TSelf& operator++()
+			void write(const void* data, size_t size)
 			{
-				if (current_ != end_ && ++current_ != end_)
+				if (std::fwrite(data, 1, size, file_.get()) != size)
 				{
-					if (!(func_(*current_)))
-					{
-						current_ = end_;
-					}
+					LINQ_THROW("Failed to write a spill file.");
 				}
-				return *this;
 			}
 
-			const TSelf operator++(int)
+			bool read(void* data, size_t size)
 			{
-				TSelf self = *this;
-				if (current_ != end_ && ++current_ != end_)
+				return std::fread(data, 1, size, file_.get()) == size;
+			}
+
+			std::fpos_t position() const
+			{
+				std::fpos_t position;
+				if (std::fgetpos(file_.get(), &position) != 0)
 				{
-					if (!(func_(*current_)))
-					{
-						current_ = end_;
-					}
+					LINQ_THROW("Failed to read a spill file.");
 				}
-				return self;
+				return position;
 			}
 
-			auto operator*() const -> decltype(*current_)
+			void seek(const std::fpos_t& position)
 			{
-				return *current_;
+				if (std::fsetpos(file_.get(), &position) != 0)
+				{
+					LINQ_THROW("Failed to read a spill file.");
+				}
 			}
 
-			bool operator==(const TSelf& iter) const
+			void write(const T& value)
 			{
-				return current_ == iter.current_;
+				serializer<T>::write(*this, value);
 			}
 
-			bool operator!=(const TSelf& iter) const
+			bool read(T& value)
 			{
-				return current_ != iter.current_;
+				return serializer<T>::read(*this, value);
+			}
+
+			void close()
+			{
+				if (std::fclose(file_.release()) != 0)
+				{
+					LINQ_THROW("Failed to write a spill file.");
+				}
 			}
 		};
 
-		template<typename TIterator1, typename TIterator2>
-		class concat_iterator
+		//writes a sorted run to a new spill file
+		template<typename T>
+		std::unique_ptr<spill_file> write_run(const std::vector<T>& run, const memory_budget& budget)
+		{
+			std::unique_ptr<spill_file> file(new spill_file(budget));
+			file_stream<T> stream(*file, "wb");
+			for (auto& value : run)
+			{
+				stream.write(value);
+			}
+			stream.close();
+			return file;
+		}
+
+		//sorted runs of a spilled result, the last one may stay in memory
+		template<typename T>
+		struct run_set
+		{
+			std::vector<std::unique_ptr<spill_file>> files;
+			std::vector<T> tail;
+		};
+
+		//runs that are complete before the first enumeration
+		template<typename T, typename TComparer>
+		class sorted_runs
 		{
-			typedef concat_iterator<TIterator1, TIterator2> TSelf;
 		private:
-			TIterator1 current1_;
-			TIterator1 end1_;
-			TIterator2 current2_;
-			TIterator2 end2_;
+			run_set<T> runs_;
 		public:
-			concat_iterator() = default;
-			concat_iterator(const TIterator1& current1, const TIterator1& end1, const TIterator2& current2, const TIterator2& end2)
-				:current1_(current1), end1_(end1), current2_(current2), end2_(end2)
+			typedef T element_type;
+			TComparer comparer;
+
+			sorted_runs(run_set<T>&& runs, const TComparer& comparer)
+				:runs_(std::move(runs)), comparer(comparer)
 			{
 
 			}
 
-			TSelf& operator++()
+			const spill::run_set<T>& runs() const
 			{
-				if (current1_ != end1_)
-				{
-					++current1_;
-				}
-				else if (current2_ != end2_)
+				return runs_;
+			}
+		};
+
+		struct first_less
+		{
+			template<typename T>
+			bool operator()(const T& a, const T& b) const
+			{
+				return a.first < b.first;
+			}
+		};
+
+		struct select_second
+		{
+			template<typename T>
+			const typename T::second_type& operator()(const T& p) const
+			{
+				return p.second;
+			}
+		};
+
+		//partitions are split again with a different hash until max_depth, deeper partitions stay in memory
+		const size_t fan_out = 16;
+		const size_t max_depth = 4;
+
+		inline size_t partition_of(size_t hash, size_t depth)
+		{
+			unsigned long long h = (static_cast<unsigned long long>(hash) ^ (depth * 0xC2B2AE3D27D4EB4Full)) * 0x9E3779B97F4A7C15ull;
+			return static_cast<size_t>((h ^ (h >> 32)) % fan_out);
+		}
+
+		//fan_out spill files, written while partitioning and read back one partition at a time
+		template<typename T>
+		class partition_set
+		{
+		private:
+			std::vector<std::unique_ptr<spill_file>> files_;
+			std::vector<file_stream<T>> streams_;
+		public:
+			explicit partition_set(const memory_budget& budget)
+			{
+				streams_.reserve(fan_out);
+				for (size_t partition = 0; partition < fan_out; ++partition)
 				{
-					++current2_;
+					files_.emplace_back(new spill_file(budget));
+					streams_.emplace_back(*files_.back(), "wb");
 				}
+			}
 
-				return *this;
+			void write(size_t partition, const T& value)
+			{
+				streams_[partition].write(value);
 			}
 
-			const TSelf operator++(int)
+			void close()
 			{
-				TSelf self = *this;
-				if (current1_ != end1_)
+				for (auto& stream : streams_)
 				{
-					++current1_;
+					stream.close();
 				}
-				else if (current2_ != end2_)
+				streams_.clear();
+			}
+
+			template<typename TFunc>
+			void read(size_t partition, const TFunc& func) const
+			{
+				file_stream<T> stream(*files_[partition], "rb");
+				T value;
+				while (stream.read(value))
 				{
-					++current2_;
+					func(value);
 				}
-				return self;
 			}
+		};
 
-			auto operator*() const -> decltype(*current1_)
+		//the sources of the spilling operators call func once per record
+		template<typename T>
+		class partition_source
+		{
+		private:
+			const partition_set<T>* set_;
+			size_t partition_;
+		public:
+			partition_source(const partition_set<T>& set, size_t partition)
+				:set_(&set), partition_(partition)
 			{
-				return (current1_ != end1_) ? *current1_ : *current2_;
+
 			}
 
-			bool operator==(const TSelf& iter) const
+			template<typename TFunc>
+			void operator()(const TFunc& func) const
 			{
-				if (current1_ != end1_) return current1_ == iter.current1_;
-				return current2_ == iter.current2_;
+				set_->read(partition_, func);
 			}
+		};
 
-			bool operator!=(const TSelf& iter) const
+		//a result that never spilled stays in memory
+		template<typename T>
+		void emit(run_set<T>& out, std::vector<T>&& run, size_t depth, const memory_budget& budget)
+		{
+			if (depth == 0)
 			{
-				if (current1_ != end1_) return current1_ != iter.current1_;
-				return current2_ != iter.current2_;
+				out.tail = std::move(run);
 			}
-		};
-        template<typename TIterator1, typename TIterator2>
-        class zip_iterator
-        {
-            typedef zip_iterator<TIterator1, TIterator2> TSelf;
-        private:
-            TIterator1 current1_;
-            TIterator1 end1_;
-            TIterator2 current2_;
-            TIterator2 end2_;
-			using TPair = std::pair<clean_type<decltype(*current1_)>, clean_type<decltype(*current2_)>>;
-			std::vector<TPair> pairs_;
-			size_t pair_index_;
-        public:
-            zip_iterator() = default;
-            zip_iterator(const TIterator1& current1, const TIterator1& end1, const TIterator2& current2, const TIterator2& end2)
-				:current1_(current1), end1_(end1), current2_(current2), end2_(end2), pair_index_(0)
-            {
-				auto c1 = current1;
-				auto c2 = current2;
-				while (c1 != end1_ && c2 != end2_)
+			else if (!run.empty())
+			{
+				out.files.push_back(write_run(run, budget));
+			}
+		}
+
+		//adds the source to set until it outgrows the budget, then partitions the set and the rest of the source
+		template<typename T, typename TSource>
+		std::unique_ptr<partition_set<T>> collect_set(const TSource& source, size_t depth, const memory_budget& budget, std::set<T>& set)
+		{
+			std::unique_ptr<partition_set<T>> partitions;
+			std::hash<T> hash;
+			source([&](const T& value)
+			{
+				if (partitions)
 				{
-					pairs_.push_back(std::make_pair(*c1, *c2));
-                    ++c1;
-                    ++c2;
+					partitions->write(partition_of(hash(value), depth), value);
 				}
-				if (c1 != end1_ || c2 != end2_) throw linq_exception("The size of two sequence is not matched.");
-            }
-			TSelf& operator++()
+				else if (set.insert(value).second && set.size() * sizeof(T) > budget.bytes && depth < max_depth)
+				{
+					partitions.reset(new partition_set<T>(budget));
+					for (auto& element : set)
+					{
+						partitions->write(partition_of(hash(element), depth), element);
+					}
+					set.clear();
+				}
+			});
+			return partitions;
+		}
+
+		//every run is sorted and no two runs share a value
+		template<typename T, typename TSource>
+		void distinct(const TSource& source, size_t depth, const memory_budget& budget, run_set<T>& out)
+		{
+			std::set<T> set;
+			auto partitions = collect_set(source, depth, budget, set);
+			if (!partitions)
 			{
-				++pair_index_;
-				++current1_;
-				++current2_;
-				return *this;
+				emit(out, std::vector<T>(set.begin(), set.end()), depth, budget);
+				return;
 			}
-
-			const TSelf operator++(int)
+			partitions->close();
+			for (size_t partition = 0; partition < fan_out; ++partition)
 			{
-				TSelf self = *this;
-				++pair_index_;
-				++current1_;
-				++current2_;
-				return self;
+				distinct<T>(partition_source<T>(*partitions, partition), depth + 1, budget, out);
 			}
+		}
 
-			TPair operator*() const
+		//only the left side is kept in memory, the right side is streamed against it
+		template<typename T, typename TLeft, typename TRight>
+		void intersect(const TLeft& left, const TRight& right, size_t depth, const memory_budget& budget, run_set<T>& out)
+		{
+			std::set<T> set;
+			std::hash<T> hash;
+			auto lefts = collect_set(left, depth, budget, set);
+			if (!lefts)
 			{
-				return pairs_[pair_index_];
+				std::vector<T> run;
+				right([&](const T& value)
+				{
+					auto it = set.find(value);
+					if (it != set.end())
+					{
+						run.push_back(*it);
+						set.erase(it);
+					}
+				});
+				std::sort(run.begin(), run.end());
+				emit(out, std::move(run), depth, budget);
+				return;
+			}
+			lefts->close();
+			partition_set<T> rights(budget);
+			right([&](const T& value)
+			{
+				rights.write(partition_of(hash(value), depth), value);
+			});
+			rights.close();
+			for (size_t partition = 0; partition < fan_out; ++partition)
+			{
+				intersect<T>(partition_source<T>(*lefts, partition), partition_source<T>(rights, partition), depth + 1, budget, out);
 			}
+		}
 
-			bool operator==(const TSelf& iter) const
+		//left records carry their source index, every run is sorted by it
+		template<typename T, typename TLeft, typename TRight>
+		void except(const TLeft& left, const TRight& right, size_t depth, const memory_budget& budget, run_set<std::pair<size_t, T>>& out)
+		{
+			typedef std::pair<size_t, T> TRecord;
+			std::set<T> excluded;
+			std::hash<T> hash;
+			auto rights = collect_set(right, depth, budget, excluded);
+			std::unique_ptr<partition_set<TRecord>> lefts;
+			if (rights) lefts.reset(new partition_set<TRecord>(budget));
+			std::vector<TRecord> run;
+			left([&](const TRecord& record)
 			{
-				return current1_ == iter.current1_;
+				if (lefts)
+				{
+					lefts->write(partition_of(hash(record.second), depth), record);
+				}
+				else if (excluded.insert(record.second).second)
+				{
+					run.push_back(record);
+					if (excluded.size() * sizeof(T) > budget.bytes && depth < max_depth)
+					{
+						//the kept records are final, everything seen so far still excludes later duplicates
+						out.files.push_back(write_run(run, budget));
+						run.clear();
+						rights.reset(new partition_set<T>(budget));
+						for (auto& element : excluded)
+						{
+							rights->write(partition_of(hash(element), depth), element);
+						}
+						excluded.clear();
+						lefts.reset(new partition_set<TRecord>(budget));
+					}
+				}
+			});
+			if (!lefts)
+			{
+				emit(out, std::move(run), depth, budget);
+				return;
+			}
+			lefts->close();
+			rights->close();
+			for (size_t partition = 0; partition < fan_out; ++partition)
+			{
+				except<T>(partition_source<TRecord>(*lefts, partition), partition_source<T>(*rights, partition), depth + 1, budget, out);
 			}
+		}
 
-			bool operator!=(const TSelf& iter) const
+		//runs of (key, values) sorted by key, values keep their source order
+		template<typename TKey, typename TValue, typename TSource>
+		void group_by(const TSource& source, size_t depth, const memory_budget& budget, run_set<std::pair<TKey, std::vector<TValue>>>& out)
+		{
+			typedef std::pair<TKey, TValue> TRecord;
+			std::map<TKey, std::vector<TValue>> groups;
+			std::unique_ptr<partition_set<TRecord>> partitions;
+			std::hash<TKey> hash;
+			size_t bytes = 0;
+			source([&](const TRecord& record)
 			{
-				return current1_ != iter.current1_;
+				if (partitions)
+				{
+					partitions->write(partition_of(hash(record.first), depth), record);
+					return;
+				}
+				auto it = groups.find(record.first);
+				if (it == groups.end())
+				{
+					it = groups.emplace(record.first, std::vector<TValue>()).first;
+					bytes += sizeof(TKey);
+				}
+				it->second.push_back(record.second);
+				bytes += sizeof(TValue);
+				if (bytes > budget.bytes && depth < max_depth)
+				{
+					partitions.reset(new partition_set<TRecord>(budget));
+					for (auto& group : groups)
+					{
+						for (auto& value : group.second)
+						{
+							partitions->write(partition_of(hash(group.first), depth), TRecord(group.first, value));
+						}
+					}
+					groups.clear();
+				}
+			});
+			if (!partitions)
+			{
+				std::vector<std::pair<TKey, std::vector<TValue>>> run;
+				run.reserve(groups.size());
+				for (auto& group : groups)
+				{
+					run.emplace_back(group.first, std::move(group.second));
+				}
+				emit(out, std::move(run), depth, budget);
+				return;
+			}
+			partitions->close();
+			for (size_t partition = 0; partition < fan_out; ++partition)
+			{
+				group_by<TKey, TValue>(partition_source<TRecord>(*partitions, partition), depth + 1, budget, out);
 			}
+		}
+	}
+
+	//streaming binary sinks of to_file and to_stream
+	namespace io
+	{
+		//direct writes need buffers, sizes and file offsets aligned to the device block
+		const size_t block_alignment = 4096;
 
+		struct write_options
+		{
+			//bytes handed to the sink per write, rounded up to block_alignment
+			size_t buffer_size = 1 << 20;
+			//to_file opens the file with O_DIRECT where the platform and file system allow it
+			bool direct = false;
 		};
 
-		template<typename TContainerPointer>
-		class adapter_iterator
+		//writes every element through serializer<TElement>
+		struct default_serializer
+		{
+			template<typename TWriter, typename T>
+			void operator()(TWriter& writer, const T& value) const
+			{
+				serializer<T>::write(writer, value);
+			}
+		};
+
+		class stream_sink
 		{
-			typedef adapter_iterator<TContainerPointer> TSelf;
 		private:
-			TContainerPointer p_;
-			using TContainerIterator = decltype(p_->begin());
-			TContainerIterator current_;
-			TContainerIterator end_;
+			std::ostream* out_;
 
+			void check() const
+			{
+				if (!*out_) LINQ_THROW("Failed to write to the stream.");
+			}
 		public:
-			adapter_iterator() = default;
-			adapter_iterator(const TContainerPointer& p, const TContainerIterator& current, const TContainerIterator& end)
-				:p_(p), current_(current), end_(end)
+			explicit stream_sink(std::ostream& out)
+				:out_(&out)
 			{
 
 			}
 
-			TSelf& operator++()
+			bool gather() const
 			{
-				++current_;
-				return *this;
+				return true;
 			}
 
-			const TSelf operator++(int)
+			void write(const char* data, size_t size)
 			{
-				TSelf self = *this;
-				++current_;
-				return self;
+				out_->write(data, static_cast<std::streamsize>(size));
+				check();
 			}
 
-			auto operator*() const -> decltype(*current_)
+			void write(const char* data1, size_t size1, const char* data2, size_t size2)
 			{
-				return *current_;
+				write(data1, size1);
+				write(data2, size2);
 			}
 
-			bool operator==(const TSelf& iter) const
+			void close()
 			{
-				return current_ == iter.current_;
+				out_->flush();
+				check();
 			}
+		};
 
-			bool operator!=(const TSelf& iter) const
+#if defined(__unix__) || defined(__APPLE__)
+		//a file descriptor, large payloads go out with the pending block in one writev
+		class file_sink
+		{
+		private:
+			int fd_;
+			bool direct_;
+
+			void write(struct iovec* iov, int count)
 			{
-				return current_ != iter.current_;
+				while (count > 0)
+				{
+					ssize_t written = ::writev(fd_, iov, count);
+					if (written < 0)
+					{
+						if (errno == EINTR) continue;
+						LINQ_THROW("Failed to write a file.");
+					}
+					size_t rest = static_cast<size_t>(written);
+					while (count > 0 && rest >= iov->iov_len)
+					{
+						rest -= iov->iov_len;
+						++iov;
+						--count;
+					}
+					if (count > 0)
+					{
+						iov->iov_base = static_cast<char*>(iov->iov_base) + rest;
+						iov->iov_len -= rest;
+					}
+				}
+			}
+		public:
+			file_sink(const std::string& path, bool direct)
+				:fd_(-1), direct_(false)
+			{
+				int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+				if (direct)
+				{
+					fd_ = ::open(path.c_str(), flags | O_DIRECT, 0666);
+					direct_ = fd_ >= 0;
+				}
+#endif
+				if (fd_ < 0) fd_ = ::open(path.c_str(), flags, 0666);
+				if (fd_ < 0) LINQ_THROW("Failed to open a file.");
 			}
-		};
-	}
 
-	namespace iterators
-	{
-		template<typename TIterator, typename TPredict>
-		using where_iter = where_iterator<TIterator, TPredict>;
+			//takes over an open descriptor
+			explicit file_sink(int fd)
+				:fd_(fd), direct_(false)
+			{
+				if (fd_ < 0) LINQ_THROW("Failed to open a file.");
+			}
 
-		template<typename TIterator, typename TPredict>
-		using select_iter = select_iterator<TIterator, TPredict>;
+			file_sink(const file_sink&) = delete;
+			file_sink& operator=(const file_sink&) = delete;
 
-		template<typename TIterator, typename TPredict>
-		using single_iter = single_iterator<TIterator, TPredict>;
+			~file_sink()
+			{
+				if (fd_ >= 0) ::close(fd_);
+			}
 
-		template<typename TIterator>
-		using skip_iter = skip_iterator<TIterator>;
+			//user memory is not aligned for O_DIRECT
+			bool gather() const
+			{
+				return !direct_;
+			}
 
-		template<typename TIterator, typename TPredict>
-		using skip_while_iter = skip_while_iterator<TIterator, TPredict>;
+			void write(const char* data, size_t size)
+			{
+#ifdef O_DIRECT
+				if (direct_ && size % block_alignment != 0)
+				{
+					//the last partial block goes through the page cache
+					::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) & ~O_DIRECT);
+					direct_ = false;
+				}
+#endif
+				struct iovec iov[1] = { { const_cast<char*>(data), size } };
+				write(iov, 1);
+			}
 
-		template<typename TIterator>
-		using take_iter = take_iterator<TIterator>;
+			void write(const char* data1, size_t size1, const char* data2, size_t size2)
+			{
+				struct iovec iov[2] = { { const_cast<char*>(data1), size1 }, { const_cast<char*>(data2), size2 } };
+				write(iov, 2);
+			}
 
-		template<typename TIterator, typename TPredict>
-		using take_while_iter = take_while_iterator<TIterator, TPredict>;
+			void close()
+			{
+				int fd = fd_;
+				fd_ = -1;
+				if (::close(fd) != 0) LINQ_THROW("Failed to write a file.");
+			}
+		};
+#else
+		class file_sink
+		{
+		private:
+			std::unique_ptr<std::FILE, int(*)(std::FILE*)> file_;
+		public:
+			file_sink(const std::string& path, bool)
+				:file_(std::fopen(path.c_str(), "wb"), &std::fclose)
+			{
+				if (!file_) LINQ_THROW("Failed to open a file.");
+				std::setvbuf(file_.get(), nullptr, _IONBF, 0);
+			}
 
-		template<typename TIterator1, typename TIterator2>
-		using concat_iter = concat_iterator<TIterator1, TIterator2>;
+			bool gather() const
+			{
+				return true;
+			}
 
-		template<typename TContainerPointer>
-		using adapter_iter = adapter_iterator<TContainerPointer>;
+			void write(const char* data, size_t size)
+			{
+				if (std::fwrite(data, 1, size, file_.get()) != size) LINQ_THROW("Failed to write a file.");
+			}
 
-		template<typename TIterator1, typename TIterator2>
-		using zip_iter = zip_iterator<TIterator1, TIterator2>;
+			void write(const char* data1, size_t size1, const char* data2, size_t size2)
+			{
+				write(data1, size1);
+				write(data2, size2);
+			}
 
-        template<typename TIterator>
-        using any_type_iter = any_type_iterator<TIterator>;
+			void close()
+			{
+				if (std::fclose(file_.release()) != 0) LINQ_THROW("Failed to write a file.");
+			}
+		};
+#endif
 
-        template<typename TIterator>
-        using empty_iter = empty_iterator<TIterator>;
-	}
+		//collects small writes in an aligned block, payloads of a block or more are not copied when the sink can gather
+		template<typename TSink>
+		class block_writer
+		{
+		private:
+			TSink sink_;
+			std::unique_ptr<char[]> storage_;
+			char* data_;
+			size_t capacity_;
+			size_t size_;
 
-	template<typename TIterator>
-	class Queryable;
+			void flush()
+			{
+				sink_.write(data_, size_);
+				size_ = 0;
+			}
+		public:
+			template<typename... TArgs>
+			block_writer(const write_options& options, TArgs&&... args)
+				:sink_(std::forward<TArgs>(args)...), size_(0)
+			{
+				capacity_ = std::max<size_t>(1, (options.buffer_size + block_alignment - 1) / block_alignment) * block_alignment;
+				storage_.reset(new char[capacity_ + block_alignment]);
+				void* data = storage_.get();
+				size_t space = capacity_ + block_alignment;
+				data_ = static_cast<char*>(std::align(block_alignment, capacity_, data, space));
+			}
 
-    template<typename T>
-    class linq : public Queryable<iterators::any_type_iter<T>>
-    {
-    public:
-        linq() = default;
+			block_writer(const block_writer&) = delete;
+			block_writer& operator=(const block_writer&) = delete;
 
-        template<typename TIterator>
-        linq(const Queryable<TIterator>& e)
-            :Queryable<iterators::any_type_iter<T>>(
-            iterators::any_type_iter<T>(e.begin()),
-            iterators::any_type_iter<T>(e.end())
-            )
-        {
-        }
-    };
+			void write(const void* data, size_t size)
+			{
+				auto bytes = static_cast<const char*>(data);
+				if (size >= capacity_ && sink_.gather())
+				{
+					sink_.write(data_, size_, bytes, size);
+					size_ = 0;
+					return;
+				}
+				while (size != 0)
+				{
+					size_t n = std::min(size, capacity_ - size_);
+					std::memcpy(data_ + size_, bytes, n);
+					size_ += n;
+					bytes += n;
+					size -= n;
+					if (size_ == capacity_) flush();
+				}
+			}
 
-	template <typename TIterator>
-	constexpr Queryable<TIterator> from(const TIterator& begin, const TIterator& end)
+			//writes the last partial block, nothing is written after an exception
+			void close()
+			{
+				if (size_ != 0) flush();
+				sink_.close();
+			}
+		};
+	}
+
+	//integral averages are computed in double
+	template<typename T>
+	using average_type = typename std::conditional<std::is_integral<T>::value, double, T>::type;
+
+	template<typename T>
+	struct statistics
 	{
-		return Queryable<TIterator>(begin, end);
+		size_t count;
+		T sum;
+		T min;
+		T max;
+		double mean;
+		//population variance
+		double variance;
+	};
+
+	//single pass aggregators for aggregate_many, each one binds to the element type through accumulator<TElement>
+	namespace aggregators
+	{
+		struct identity
+		{
+			template<typename T>
+			const T& operator()(const T& value) const
+			{
+				return value;
+			}
+		};
+
+		template<typename TAggregator, typename TElement>
+		using accumulator_t = typename TAggregator::template accumulator<TElement>;
+
+		template<typename TAggregator, typename TElement>
+		using result_t = decltype(std::declval<const accumulator_t<TAggregator, TElement>&>().result());
+
+		template<typename TPredict, typename TElement>
+		using selected_t = clean_type<decltype(std::declval<const TPredict&>()(std::declval<const TElement&>()))>;
+
+		class count
+		{
+		public:
+			template<typename TElement>
+			class accumulator
+			{
+			private:
+				size_t count_;
+			public:
+				accumulator(const count&)
+					:count_(0)
+				{
+
+				}
+
+				void accumulate(const TElement&)
+				{
+					++count_;
+				}
+
+				void merge(const accumulator& other)
+				{
+					count_ += other.count_;
+				}
+
+				size_t result() const
+				{
+					return count_;
+				}
+			};
+		};
+
+		template<typename TPredict>
+		class sum
+		{
+		public:
+			TPredict func;
+
+			sum(const TPredict& func)
+				:func(func)
+			{
+
+			}
+
+			template<typename TElement>
+			class accumulator
+			{
+				using TValue = selected_t<TPredict, TElement>;
+			private:
+				TPredict func_;
+				TValue sum_;
+			public:
+				accumulator(const sum& aggregator)
+					:func_(aggregator.func), sum_()
+				{
+
+				}
+
+				void accumulate(const TElement& element)
+				{
+					sum_ += func_(element);
+				}
+
+				void merge(const accumulator& other)
+				{
+					sum_ += other.sum_;
+				}
+
+				TValue result() const
+				{
+					return sum_;
+				}
+			};
+		};
+
+		template<typename TPredict, bool Max>
+		class extremum
+		{
+		public:
+			TPredict func;
+
+			extremum(const TPredict& func)
+				:func(func)
+			{
+
+			}
+
+			template<typename TElement>
+			class accumulator
+			{
+				using TValue = selected_t<TPredict, TElement>;
+			private:
+				TPredict func_;
+				TValue value_;
+				bool has_value_;
+
+				void update(const TValue& value)
+				{
+					if (!has_value_ || (Max ? value_ < value : value < value_))
+					{
+						value_ = value;
+						has_value_ = true;
+					}
+				}
+			public:
+				accumulator(const extremum& aggregator)
+					:func_(aggregator.func), value_(), has_value_(false)
+				{
+
+				}
+
+				void accumulate(const TElement& element)
+				{
+					update(func_(element));
+				}
+
+				void merge(const accumulator& other)
+				{
+					if (other.has_value_) update(other.value_);
+				}
+
+				TValue result() const
+				{
+					if (!has_value_) LINQ_THROW("Empty Collection");
+					return value_;
+				}
+			};
+		};
+
+		template<typename TPredict>
+		class average
+		{
+		public:
+			TPredict func;
+
+			average(const TPredict& func)
+				:func(func)
+			{
+
+			}
+
+			template<typename TElement>
+			class accumulator
+			{
+				using TValue = average_type<selected_t<TPredict, TElement>>;
+			private:
+				TPredict func_;
+				TValue sum_;
+				size_t count_;
+			public:
+				accumulator(const average& aggregator)
+					:func_(aggregator.func), sum_(), count_(0)
+				{
+
+				}
+
+				void accumulate(const TElement& element)
+				{
+					sum_ += func_(element);
+					++count_;
+				}
+
+				void merge(const accumulator& other)
+				{
+					sum_ += other.sum_;
+					count_ += other.count_;
+				}
+
+				TValue result() const
+				{
+					if (count_ == 0) LINQ_THROW("Empty Collection");
+					return sum_ / static_cast<TValue>(count_);
+				}
+			};
+		};
+
+		//mean and variance with Welford's update, merged with Chan's formula
+		template<typename TPredict>
+		class statistics
+		{
+		public:
+			TPredict func;
+
+			statistics(const TPredict& func)
+				:func(func)
+			{
+
+			}
+
+			template<typename TElement>
+			class accumulator
+			{
+				using TValue = selected_t<TPredict, TElement>;
+			private:
+				TPredict func_;
+				LL::statistics<TValue> stats_;
+				double m2_;
+			public:
+				accumulator(const statistics& aggregator)
+					:func_(aggregator.func), stats_(), m2_(0)
+				{
+
+				}
+
+				void accumulate(const TElement& element)
+				{
+					TValue value = func_(element);
+					if (stats_.count == 0 || value < stats_.min) stats_.min = value;
+					if (stats_.count == 0 || stats_.max < value) stats_.max = value;
+					stats_.sum += value;
+					++stats_.count;
+					double delta = static_cast<double>(value) - stats_.mean;
+					stats_.mean += delta / static_cast<double>(stats_.count);
+					m2_ += delta * (static_cast<double>(value) - stats_.mean);
+				}
+
+				void merge(const accumulator& other)
+				{
+					if (other.stats_.count == 0) return;
+					if (stats_.count == 0)
+					{
+						stats_ = other.stats_;
+						m2_ = other.m2_;
+						return;
+					}
+					if (other.stats_.min < stats_.min) stats_.min = other.stats_.min;
+					if (stats_.max < other.stats_.max) stats_.max = other.stats_.max;
+					stats_.sum += other.stats_.sum;
+					double n1 = static_cast<double>(stats_.count);
+					double n2 = static_cast<double>(other.stats_.count);
+					double delta = other.stats_.mean - stats_.mean;
+					stats_.mean += delta * n2 / (n1 + n2);
+					m2_ += other.m2_ + delta * delta * n1 * n2 / (n1 + n2);
+					stats_.count += other.stats_.count;
+				}
+
+				LL::statistics<TValue> result() const
+				{
+					if (stats_.count == 0) LINQ_THROW("Empty Collection");
+					auto result = stats_;
+					result.variance = m2_ / static_cast<double>(stats_.count);
+					return result;
+				}
+			};
+		};
+
+		template<typename TTuple, typename TElement, size_t... I>
+		void accumulate(TTuple& accumulators, const TElement& element, std::index_sequence<I...>)
+		{
+			int expand[] = { 0, (std::get<I>(accumulators).accumulate(element), 0)... };
+			(void)expand;
+		}
+
+		template<typename TTuple, size_t... I>
+		void merge(TTuple& accumulators, const TTuple& other, std::index_sequence<I...>)
+		{
+			int expand[] = { 0, (std::get<I>(accumulators).merge(std::get<I>(other)), 0)... };
+			(void)expand;
+		}
+
+		template<typename TTuple, size_t... I>
+		auto results(const TTuple& accumulators, std::index_sequence<I...>) -> decltype(std::make_tuple(std::get<I>(accumulators).result()...))
+		{
+			return std::make_tuple(std::get<I>(accumulators).result()...);
+		}
 	}
 
-	template<typename TContainer>
-	constexpr auto from(const TContainer &container) -> decltype(Queryable<decltype(std::begin(container))>(std::begin(container), std::end(container)))
+	inline aggregators::count count_of()
 	{
-		return Queryable<decltype(std::begin(container))>(std::begin(container), std::end(container));
+		return aggregators::count();
 	}
 
-    template<typename T>
-    constexpr auto from(const std::initializer_list<T> &list) -> decltype(Queryable<decltype(std::begin(list))>(std::begin(list), std::end(list)))
-    {
-        return Queryable<decltype(std::begin(list))>(std::begin(list), std::end(list));
-    }
+	template<typename TPredict = aggregators::identity>
+	aggregators::sum<TPredict> sum_of(const TPredict& func = TPredict())
+	{
+		return aggregators::sum<TPredict>(func);
+	}
 
-    template<typename TContainer>
-    constexpr auto from_values(const TContainer &container)
-    {
-        using TEle = clean_type<decltype(*std::begin(container))>;
-        std::shared_ptr<std::vector<TEle>> p = std::make_shared<std::vector<TEle>>(std::begin(container), std::end(container));
-        return Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TEle>>>>(
-                iterators::adapter_iter<std::shared_ptr<std::vector<TEle>>>(p, p->begin(), p->end()),
-                iterators::adapter_iter<std::shared_ptr<std::vector<TEle>>>(p, p->end(), p->end())
-                );
-    }
+	template<typename TPredict = aggregators::identity>
+	aggregators::extremum<TPredict, false> min_of(const TPredict& func = TPredict())
+	{
+		return aggregators::extremum<TPredict, false>(func);
+	}
 
-    template<typename T>
-    constexpr auto from_values(const std::initializer_list<T> &list)
-    {
-        using TEle = clean_type<decltype(*std::begin(list))>;
-        std::shared_ptr<std::vector<TEle>> p = std::make_shared<std::vector<TEle>>(std::begin(list), std::end(list));
-        return Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TEle>>>>(
-                iterators::adapter_iter<std::shared_ptr<std::vector<TEle>>>(p, p->begin(), p->end()),
-                iterators::adapter_iter<std::shared_ptr<std::vector<TEle>>>(p, p->end(), p->end())
-                );
-    }
+	template<typename TPredict = aggregators::identity>
+	aggregators::extremum<TPredict, true> max_of(const TPredict& func = TPredict())
+	{
+		return aggregators::extremum<TPredict, true>(func);
+	}
 
-    template<typename TElement>
-	linq<TElement> from_empty()
+	template<typename TPredict = aggregators::identity>
+	aggregators::average<TPredict> average_of(const TPredict& func = TPredict())
 	{
-		return Queryable<iterators::empty_iter<TElement>>(
-			iterators::empty_iter<TElement>(),
-			iterators::empty_iter<TElement>()
-			);
+		return aggregators::average<TPredict>(func);
 	}
 
-	template<typename TIterator>
-	class Queryable
+	template<typename TPredict = aggregators::identity>
+	aggregators::statistics<TPredict> statistics_of(const TPredict& func = TPredict())
 	{
-		using TSelf = Queryable<TIterator>;
-		using TElement = clean_type<value_type<TIterator>>;
-	private:
-		TIterator begin_;
-		TIterator end_;
+		return aggregators::statistics<TPredict>(func);
+	}
+
+	//summation strategies for sum(mode) and average(mode)
+	//the blocked kernels keep independent lanes so the inner loops vectorize, do not build them with -ffast-math
+	namespace summation
+	{
+		template<typename T>
+		using widened_type = typename std::conditional<std::is_same<T, float>::value, double,
+			typename std::conditional<std::is_floating_point<T>::value, long double,
+			typename std::conditional<std::is_signed<T>::value, long long, unsigned long long>::type>::type>::type;
+
+		const size_t block_size = 256;
+		const size_t lanes = 8;
+
+		//copies the source into a contiguous block and calls kernel(block, size) for every full or last block
+		template<typename T, typename TIterator, typename TKernel>
+		void for_each_block(TIterator first, TIterator last, TKernel& kernel)
+		{
+			T block[block_size];
+			size_t size = 0;
+			for (; first != last; ++first)
+			{
+				block[size++] = static_cast<T>(*first);
+				if (size == block_size)
+				{
+					kernel(block, size);
+					size = 0;
+				}
+			}
+			if (size != 0) kernel(block, size);
+		}
+
+		struct naive_policy
+		{
+			template<typename T, typename TIterator>
+			static T sum(TIterator first, TIterator last)
+			{
+				T result = T();
+				for (; first != last; ++first)
+				{
+					result += *first;
+				}
+				return result;
+			}
+		};
+
+		//lane sums inside a block, blocks combined by a binary cascade, error grows with log n
+		struct pairwise_policy
+		{
+			template<typename T, typename TIterator>
+			static T sum(TIterator first, TIterator last)
+			{
+				static_assert(std::is_floating_point<T>::value, "pairwise summation needs a floating point element");
+				T levels[64] = {};
+				size_t filled = 0;
+				auto kernel = [&](const T* block, size_t size)
+				{
+					T acc[lanes] = {};
+					size_t i = 0;
+					for (; i + lanes <= size; i += lanes)
+					{
+						for (size_t j = 0; j < lanes; ++j)
+						{
+							acc[j] += block[i + j];
+						}
+					}
+					for (size_t j = 0; j < size % lanes; ++j)
+					{
+						acc[j] += block[i + j];
+					}
+					T partial = ((acc[0] + acc[1]) + (acc[2] + acc[3])) + ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+					//add into the cascade like a binary counter
+					size_t level = 0;
+					for (size_t bits = filled; bits & 1; bits >>= 1, ++level)
+					{
+						partial += levels[level];
+						levels[level] = T();
+					}
+					levels[level] = partial;
+					++filled;
+				};
+				for_each_block<T>(first, last, kernel);
+				T result = T();
+				for (size_t level = 0; level < 64; ++level)
+				{
+					result += levels[level];
+				}
+				return result;
+			}
+		};
+
+		//compensated summation, Kahan or Neumaier in every lane
+		template<bool Neumaier>
+		struct compensated_policy
+		{
+			template<typename T, typename TIterator>
+			static T sum(TIterator first, TIterator last)
+			{
+				static_assert(std::is_floating_point<T>::value, "compensated summation needs a floating point element");
+				T s[lanes] = {};
+				T c[lanes] = {};
+				auto add = [](T& sum, T& compensation, T value)
+				{
+					if (Neumaier)
+					{
+						T t = sum + value;
+						compensation += std::abs(sum) >= std::abs(value) ? (sum - t) + value : (value - t) + sum;
+						sum = t;
+					}
+					else
+					{
+						T y = value - compensation;
+						T t = sum + y;
+						compensation = (t - sum) - y;
+						sum = t;
+					}
+				};
+				auto kernel = [&](const T* block, size_t size)
+				{
+					size_t i = 0;
+					for (; i + lanes <= size; i += lanes)
+					{
+						for (size_t j = 0; j < lanes; ++j)
+						{
+							add(s[j], c[j], block[i + j]);
+						}
+					}
+					for (size_t j = 0; j < size % lanes; ++j)
+					{
+						add(s[j], c[j], block[i + j]);
+					}
+				};
+				for_each_block<T>(first, last, kernel);
+				//fold the lanes with Neumaier, carrying every lane's compensation
+				T result = T();
+				T compensation = T();
+				for (size_t j = 0; j < lanes; ++j)
+				{
+					T value = Neumaier ? s[j] + c[j] : s[j] - c[j];
+					T t = result + value;
+					compensation += std::abs(result) >= std::abs(value) ? (result - t) + value : (value - t) + result;
+					result = t;
+				}
+				return result + compensation;
+			}
+		};
+
+		//accumulates in a wider type and returns it, float in double, double in long double, integers in 64 bits
+		struct widened_policy
+		{
+			template<typename T, typename TIterator>
+			static widened_type<T> sum(TIterator first, TIterator last)
+			{
+				typedef widened_type<T> TWide;
+				TWide acc[lanes] = {};
+				auto kernel = [&](const TWide* block, size_t size)
+				{
+					size_t i = 0;
+					for (; i + lanes <= size; i += lanes)
+					{
+						for (size_t j = 0; j < lanes; ++j)
+						{
+							acc[j] += block[i + j];
+						}
+					}
+					for (size_t j = 0; j < size % lanes; ++j)
+					{
+						acc[j] += block[i + j];
+					}
+				};
+				for_each_block<TWide>(first, last, kernel);
+				TWide result = TWide();
+				for (size_t j = 0; j < lanes; ++j)
+				{
+					result += acc[j];
+				}
+				return result;
+			}
+		};
+
+		//counts the elements a policy reads, so average sums and counts in one traversal
+		template<typename TIterator>
+		class counting_iterator
+		{
+			typedef counting_iterator<TIterator> TSelf;
+		private:
+			TIterator current_;
+			size_t* count_;
+		public:
+			counting_iterator(const TIterator& current, size_t* count)
+				:current_(current), count_(count)
+			{
+
+			}
+
+			TSelf& operator++()
+			{
+				++current_;
+				++*count_;
+				return *this;
+			}
+
+			auto operator*() const -> decltype(*current_)
+			{
+				return *current_;
+			}
+
+			bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_;
+			}
+
+			bool operator!=(const TSelf& iter) const
+			{
+				return current_ != iter.current_;
+			}
+		};
+
+		constexpr naive_policy naive{};
+		constexpr pairwise_policy pairwise{};
+		constexpr compensated_policy<false> kahan{};
+		constexpr compensated_policy<true> neumaier{};
+		constexpr widened_policy widened{};
+	}
+
+	//comparers used by order_by and then_by
+	template<typename TPredict, bool Descending>
+	class key_comparer
+	{
+	private:
+		TPredict key_;
+	public:
+		key_comparer(const TPredict& key)
+			:key_(key)
+		{
+
+		}
+
+		template<typename T>
+		bool operator()(const T& a, const T& b) const
+		{
+			return Descending ? key_(b) < key_(a) : key_(a) < key_(b);
+		}
+	};
+
+	template<typename TComparer1, typename TComparer2>
+	class then_comparer
+	{
+	private:
+		TComparer1 first_;
+		TComparer2 second_;
+	public:
+		then_comparer(const TComparer1& first, const TComparer2& second)
+			:first_(first), second_(second)
+		{
+
+		}
+
+		template<typename T>
+		bool operator()(const T& a, const T& b) const
+		{
+			if (first_(a, b)) return true;
+			if (first_(b, a)) return false;
+			return second_(a, b);
+		}
+	};
+
+	//conjunction of two where predicates
+	template<typename TPredict1, typename TPredict2>
+	class and_predicate
+	{
+	private:
+		TPredict1 first_;
+		TPredict2 second_;
+	public:
+		constexpr and_predicate(const TPredict1& first, const TPredict2& second)
+			:first_(first), second_(second)
+		{
+
+		}
+
+		template<typename T>
+		constexpr bool operator()(const T& value) const
+		{
+			return first_(value) && second_(value);
+		}
+	};
+
+	//row of a from_columns source, a column is only read when it is accessed
+	template<typename... TColumns>
+	class column_row
+	{
+	private:
+		std::tuple<const TColumns*...> columns_;
+		size_t index_;
+	public:
+		column_row(const std::tuple<const TColumns*...>& columns, size_t index)
+			:columns_(columns), index_(index)
+		{
+
+		}
+
+		template<size_t I>
+		const typename std::tuple_element<I, std::tuple<TColumns...>>::type& get() const
+		{
+			return std::get<I>(columns_)[index_];
+		}
+
+		size_t index() const
+		{
+			return index_;
+		}
+	};
+
+	template<size_t I, typename... TColumns>
+	const typename std::tuple_element<I, std::tuple<TColumns...>>::type& get(const column_row<TColumns...>& row)
+	{
+		return row.template get<I>();
+	}
+
+	//column accessor, select(column<I>()) over from_columns yields the column itself
+	template<size_t I>
+	struct column
+	{
+		template<typename... TColumns>
+		const typename std::tuple_element<I, std::tuple<TColumns...>>::type& operator()(const column_row<TColumns...>& row) const
+		{
+			return row.template get<I>();
+		}
+	};
+
+	//adapters keep their functor as a base when it is stateless, so it takes no space
+	//functors that cannot be assigned or default constructed are boxed, so the iterators
+	//still model the standard iterator concepts
+	template<typename TFunc>
+	struct func_holder_kind : std::integral_constant<int,
+		std::is_empty<TFunc>::value && !std::is_final<TFunc>::value ? 0 :
+		std::is_default_constructible<TFunc>::value && std::is_copy_assignable<TFunc>::value ? 1 : 2> {};
+
+	template<typename TFunc, int = func_holder_kind<TFunc>::value>
+	class func_holder : private TFunc
+	{
+	public:
+		func_holder() = default;
+		func_holder(const func_holder&) = default;
+		constexpr func_holder(const TFunc& func)
+			:TFunc(func)
+		{
+
+		}
+
+		//a stateless functor has nothing to assign
+		constexpr func_holder& operator=(const func_holder&)
+		{
+			return *this;
+		}
+
+		constexpr const TFunc& func() const
+		{
+			return *this;
+		}
+	};
+
+	template<typename TFunc>
+	class func_holder<TFunc, 1>
+	{
+	private:
+		TFunc func_;
+	public:
+		func_holder() = default;
+		constexpr func_holder(const TFunc& func)
+			:func_(func)
+		{
+
+		}
+
+		constexpr const TFunc& func() const
+		{
+			return func_;
+		}
+	};
+
+	template<typename TFunc>
+	class func_holder<TFunc, 2>
+	{
+	private:
+		union
+		{
+			TFunc func_;
+		};
+		bool engaged_;
+
+		void reset()
+		{
+			if (engaged_)
+			{
+				func_.~TFunc();
+				engaged_ = false;
+			}
+		}
+	public:
+		func_holder()
+			:engaged_(false)
+		{
+
+		}
+
+		func_holder(const TFunc& func)
+			:func_(func), engaged_(true)
+		{
+
+		}
+
+		func_holder(const func_holder& holder)
+			:engaged_(false)
+		{
+			*this = holder;
+		}
+
+		//assignment rebuilds the functor in place, lambdas have no copy assignment
+		func_holder& operator=(const func_holder& holder)
+		{
+			if (this != &holder)
+			{
+				reset();
+				if (holder.engaged_)
+				{
+					::new (static_cast<void*>(std::addressof(func_))) TFunc(holder.func_);
+					engaged_ = true;
+				}
+			}
+			return *this;
+		}
+
+		~func_holder()
+		{
+			reset();
+		}
+
+		const TFunc& func() const
+		{
+			return func_;
+		}
+	};
+
+	//member types read by iterator_traits and the C++20 iterator concepts
+	//the iterator itself is a parameter so that nested adapters never share an empty base
+	//single pass iterators give input_iterator_tag as TConcept
+	template<typename TIterator, typename TReference, typename TConcept = std::forward_iterator_tag>
+	struct iterator_types
+	{
+		typedef std::input_iterator_tag iterator_category;
+		typedef TConcept iterator_concept;
+		typedef clean_type<TReference> value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef typename std::add_pointer<typename std::remove_reference<TReference>::type>::type pointer;
+		typedef TReference reference;
+	};
+
+	template<typename TIterator, typename = void>
+	struct has_at_end : std::false_type {};
+
+	template<typename TIterator>
+	struct has_at_end<TIterator, void_t<decltype(std::declval<const TIterator&>().at_end())>> : std::true_type {};
+
+	//position of an adapter in its source, raw iterators keep the end beside them
+	//while adapters already know where they stop, so nested pipelines grow linearly
+	template<typename TIterator, bool = has_at_end<TIterator>::value>
+	class cursor
+	{
+		typedef cursor<TIterator> TSelf;
+	private:
+		TIterator current_;
+		TIterator end_;
+	public:
+		cursor() = default;
+		constexpr cursor(const TIterator& current, const TIterator& end)
+			:current_(current), end_(end)
+		{
+
+		}
+
+		constexpr const TIterator& base() const
+		{
+			return current_;
+		}
+
+		constexpr bool at_end() const
+		{
+			return current_ == end_;
+		}
+
+		constexpr TSelf& operator++()
+		{
+			++current_;
+			return *this;
+		}
+
+		constexpr auto operator*() const -> decltype(*current_)
+		{
+			return *current_;
+		}
+
+		constexpr bool operator==(const TSelf& iter) const
+		{
+			return current_ == iter.current_;
+		}
+
+		constexpr bool operator!=(const TSelf& iter) const
+		{
+			return current_ != iter.current_;
+		}
+	};
+
+	template<typename TIterator>
+	class cursor<TIterator, true>
+	{
+		typedef cursor<TIterator> TSelf;
+	private:
+		TIterator current_;
+	public:
+		cursor() = default;
+		constexpr cursor(const TIterator& current, const TIterator&)
+			:current_(current)
+		{
+
+		}
+
+		constexpr const TIterator& base() const
+		{
+			return current_;
+		}
+
+		constexpr bool at_end() const
+		{
+			return current_.at_end();
+		}
+
+		constexpr TSelf& operator++()
+		{
+			++current_;
+			return *this;
+		}
+
+		constexpr auto operator*() const -> decltype(*current_)
+		{
+			return *current_;
+		}
+
+		constexpr bool operator==(const TSelf& iter) const
+		{
+			return current_ == iter.current_;
+		}
+
+		constexpr bool operator!=(const TSelf& iter) const
+		{
+			return current_ != iter.current_;
+		}
+	};
+
+	namespace iterators
+	{
+        //empty type
+        template<typename T>
+		class empty_iterator : public iterator_types<empty_iterator<T>, T>
+		{
+			typedef empty_iterator<T> TSelf;
+		public:
+			empty_iterator() = default;
+
+			TSelf& operator++()
+			{
+				return *this;
+			}
+
+			TSelf operator++(int)
+			{
+				return *this;
+			}
+
+			T operator*()const
+			{
+				LINQ_THROW("Failed to get a value from an empty collection.");
+			}
+
+			bool operator==(const TSelf&)const
+			{
+				return true;
+			}
+
+			bool operator!=(const TSelf&)const
+			{
+				return false;
+			}
+		};
+        //any type 
+        template<typename T>
+        class any_type_iterator : public iterator_types<any_type_iterator<T>, T>
+        {
+            private:
+                class iterator_holder_base
+                {
+                    typedef iterator_holder_base TSelf;
+                    public:
+                        virtual std::shared_ptr<TSelf> next() = 0;
+                        //moves this holder when no other iterator shares it
+                        virtual void advance() = 0;
+                        virtual T deref() = 0;
+                        virtual bool equals(const std::shared_ptr<TSelf>& p) = 0;
+                };
+
+                template<typename TIterator>
+                class iterator_holder_impl : public iterator_holder_base
+                {
+                    typedef iterator_holder_impl<TIterator> TSelf;
+                    //linq<const T&> hands out references that have to outlive the adapted iterator
+                    static_assert(!std::is_reference<T>::value || stable_reference<TIterator>::value, "linq<const T&> needs a source whose elements outlive its iterators.");
+                    private:
+                        TIterator iter_;
+                    public:
+                        iterator_holder_impl(const TIterator &iter)
+                            :iter_(iter)
+                        {
+                        }
+                        std::shared_ptr<iterator_holder_base> next()
+                        {
+                            auto t = iter_;
+                            ++t;
+                            return std::make_shared<TSelf>(t);
+                        }
+                        void advance()
+                        {
+                            ++iter_;
+                        }
+                        T deref()
+                        {
+                            return *iter_;
+                        }
+                        bool equals(const std::shared_ptr<iterator_holder_base>& p)
+                        {
+                            auto impl = dynamic_cast<TSelf*>(p.get());
+                            return impl && (iter_ == impl->iter_);
+                        }
+                };
+                typedef any_type_iterator<T> TSelf;
+                std::shared_ptr<iterator_holder_base> iterator_;
+            public:
+                any_type_iterator() = default;
+                template<typename TIterator>
+                any_type_iterator(const TIterator& iter):
+                        iterator_(std::make_shared<iterator_holder_impl<TIterator>>(iter))
+                {
+                }
+                TSelf& operator++()
+                {
+                    if (iterator_.use_count() == 1)
+                    {
+                        iterator_->advance();
+                    }
+                    else
+                    {
+                        iterator_ = iterator_->next();
+                    }
+                    return *this;
+                }
+
+                TSelf operator++(int)
+                {
+                    TSelf t = *this;
+                    iterator_ = iterator_->next();
+                    return t;
+                }
+
+                T operator*()const
+                {
+                    return iterator_->deref();
+                }
+
+                bool operator==(const TSelf& it)const
+                {
+                    return iterator_->equals(it.iterator_);
+                }
+
+                bool operator!=(const TSelf& it)const
+                {
+                    return !(iterator_->equals(it.iterator_));
+                }
+        };
+		//filter, mutate
+		template<typename TIterator, typename TPredict>
+		class where_iterator : public iterator_types<where_iterator<TIterator, TPredict>, value_type<TIterator>>, private func_holder<TPredict>
+		{
+			typedef where_iterator<TIterator, TPredict> TSelf;
+		private:
+			cursor<TIterator> current_;
+
+		public:
+			where_iterator() = default;
+			constexpr where_iterator(const TIterator& current, const TIterator& end, const TPredict& func)
+				:func_holder<TPredict>(func), current_(current, end)
+			{
+				while (!current_.at_end() && !this->func()(*current_))
+				{
+					++current_;
+				}
+			}
+
+			constexpr const TIterator& base() const
+			{
+				return current_.base();
+			}
+
+			constexpr const TPredict& predicate() const
+			{
+				return this->func();
+			}
+
+			constexpr bool at_end() const
+			{
+				return current_.at_end();
+			}
+
+			constexpr TSelf& operator++()
+			{
+				while (!current_.at_end())
+				{
+					++current_;
+					if (current_.at_end()) break;
+					if (this->func()(*current_)) break;
+				}
+				return *this;
+			}
+
+			constexpr TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++*this;
+				return self;
+			}
+
+			constexpr auto operator*() const -> decltype(*current_)
+			{
+				return *current_;
+			}
+
+			constexpr bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_;
+			}
+
+			constexpr bool operator!=(const TSelf& iter) const
+			{
+				return current_ != iter.current_;
+			}
+		};
+
+
+		template<typename TIterator, typename TPredict>
+		class select_iterator : public iterator_types<select_iterator<TIterator, TPredict>, decltype(std::declval<const TPredict&>()(std::declval<value_type<TIterator>>()))>, private func_holder<TPredict>
+		{
+			typedef select_iterator<TIterator, TPredict> TSelf;
+		private:
+			cursor<TIterator> current_;
+		public:
+			select_iterator() = default;
+			constexpr select_iterator(const TIterator& current, const TIterator& end, const TPredict& func)
+				:func_holder<TPredict>(func), current_(current, end)
+			{
+
+			}
+
+			constexpr const TIterator& base() const
+			{
+				return current_.base();
+			}
+
+			constexpr bool at_end() const
+			{
+				return current_.at_end();
+			}
+
+			constexpr TSelf& operator++()
+			{
+				++current_;
+				return *this;
+			}
+
+			constexpr TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++current_;
+				return self;
+			}
+
+			constexpr auto operator*() const -> decltype(std::declval<const TPredict&>()(*current_))
+			{
+				return this->func()(*current_);
+			}
+
+			constexpr bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_;
+			}
+
+			constexpr bool operator!=(const TSelf& iter) const
+			{
+				return current_ != iter.current_;
+			}
+		};
+
+		//single with parameter
+		template<typename TIterator, typename TPredict>
+		class single_iterator : public iterator_types<single_iterator<TIterator, TPredict>, value_type<TIterator>>
+		{
+			typedef single_iterator<TIterator, TPredict> TSelf;
+		private:
+			TIterator current_;
+			TIterator end_;
+			TIterator single_;
+		public:
+			single_iterator() = default;
+			single_iterator(const TIterator& current, const TIterator& end, const TPredict& func)
+				:current_(current), end_(end), single_(current_)
+			{
+				for (auto it = current_; it != end_; ++it)
+				{
+					if (func(*it))
+					{
+						single_ = it;
+					}
+				}
+			}
+
+			TSelf& operator++()
+			{
+				current_ = end_;
+				return *this;
+			}
+
+			TSelf operator++(int)
+			{
+				TSelf self = *this;
+				current_ = end_;
+				return self;
+			}
+
+			auto operator*() const -> decltype(*single_)
+			{
+				return *single_;
+			}
+
+			bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_;
+			}
+
+			bool operator!=(const TSelf& iter) const
+			{
+				return current_ != iter.current_;
+			}
+		};
+		//skip, take
+		template<typename TIterator>
+		class skip_iterator : public iterator_types<skip_iterator<TIterator>, value_type<TIterator>>
+		{
+			typedef skip_iterator<TIterator> TSelf;
+		private:
+			cursor<TIterator> current_;
+		public:
+			skip_iterator() = default;
+			constexpr skip_iterator(const TIterator& current, const TIterator& end, size_t skip_count)
+				:current_(current, end)
+			{
+				while (skip_count > 0 && !current_.at_end())
+				{
+					--skip_count;
+					++current_;
+				}
+			}
+
+			constexpr const TIterator& base() const
+			{
+				return current_.base();
+			}
+
+			constexpr bool at_end() const
+			{
+				return current_.at_end();
+			}
+
+			constexpr TSelf& operator++()
+			{
+				++current_;
+				return *this;
+			}
+
+			constexpr TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++current_;
+				return self;
+			}
+
+			constexpr auto operator*() const -> decltype(*current_)
+			{
+				return *current_;
+			}
+
+			constexpr bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_;
+			}
+
+			constexpr bool operator!=(const TSelf& iter) const
+			{
+				return current_ != iter.current_;
+			}
+		};
+
+		template<typename TIterator, typename TPredict>
+		class skip_while_iterator : public iterator_types<skip_while_iterator<TIterator, TPredict>, value_type<TIterator>>, private func_holder<TPredict>
+		{
+			typedef skip_while_iterator<TIterator, TPredict> TSelf;
+		private:
+			cursor<TIterator> current_;
+
+		public:
+			skip_while_iterator() = default;
+			constexpr skip_while_iterator(const TIterator& current, const TIterator& end, const TPredict& func)
+				:func_holder<TPredict>(func), current_(current, end)
+			{
+				while (!current_.at_end() && this->func()(*current_))
+				{
+					++current_;
+				}
+			}
+
+			constexpr bool at_end() const
+			{
+				return current_.at_end();
+			}
+
+			constexpr TSelf& operator++()
+			{
+				++current_;
+				return *this;
+			}
+
+			constexpr TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++current_;
+				return self;
+			}
+
+			constexpr auto operator*() const -> decltype(*current_)
+			{
+				return *current_;
+			}
+
+			constexpr bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_;
+			}
+
+			constexpr bool operator!=(const TSelf& iter) const
+			{
+				return current_ != iter.current_;
+			}
+		};
+
+		template<typename TIterator>
+		class take_iterator : public iterator_types<take_iterator<TIterator>, value_type<TIterator>>
+		{
+			typedef take_iterator<TIterator> TSelf;
+		private:
+			cursor<TIterator> current_;
+			size_t count_;
+			size_t cur_count_;
+
+			//stop without assigning the end, adapters holding lambdas are not assignable
+			constexpr bool done() const
+			{
+				return cur_count_ >= count_ || current_.at_end();
+			}
+		public:
+			take_iterator() = default;
+			constexpr take_iterator(const TIterator& current, const TIterator& end, size_t take_count)
+				:current_(current, end), count_(take_count), cur_count_(0)
+			{
+
+			}
+
+			constexpr const TIterator& base() const
+			{
+				return current_.base();
+			}
+
+			constexpr size_t remaining() const
+			{
+				return cur_count_ < count_ ? count_ - cur_count_ : 0;
+			}
+
+			constexpr bool at_end() const
+			{
+				return done();
+			}
+
+			constexpr TSelf& operator++()
+			{
+				if (++cur_count_ < count_ && !current_.at_end())
+				{
+					++current_;
+				}
+				return *this;
+			}
+
+			constexpr TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++*this;
+				return self;
+			}
+
+			constexpr auto operator*() const -> decltype(*current_)
+			{
+				return *current_;
+			}
+
+			constexpr bool operator==(const TSelf& iter) const
+			{
+				return done() ? iter.done() : !iter.done() && current_ == iter.current_;
+			}
+
+			constexpr bool operator!=(const TSelf& iter) const
+			{
+				return !(*this == iter);
+			}
+		};
+
+		template<typename TIterator, typename TPredict>
+		class take_while_iterator : public iterator_types<take_while_iterator<TIterator, TPredict>, value_type<TIterator>>, private func_holder<TPredict>
+		{
+			typedef take_while_iterator<TIterator, TPredict> TSelf;
+		private:
+			cursor<TIterator> current_;
+			bool stopped_;
+
+			constexpr bool done() const
+			{
+				return stopped_ || current_.at_end();
+			}
+		public:
+			take_while_iterator() = default;
+			constexpr take_while_iterator(const TIterator& current, const TIterator& end, const TPredict& func)
+				:func_holder<TPredict>(func), current_(current, end), stopped_(!current_.at_end() && !this->func()(*current_))
+			{
+
+			}
+
+			constexpr bool at_end() const
+			{
+				return done();
+			}
+
+			constexpr TSelf& operator++()
+			{
+				if (!done() && !(++current_).at_end())
+				{
+					stopped_ = !this->func()(*current_);
+				}
+				return *this;
+			}
+
+			constexpr TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++*this;
+				return self;
+			}
+
+			constexpr auto operator*() const -> decltype(*current_)
+			{
+				return *current_;
+			}
+
+			constexpr bool operator==(const TSelf& iter) const
+			{
+				return done() ? iter.done() : !iter.done() && current_ == iter.current_;
+			}
+
+			constexpr bool operator!=(const TSelf& iter) const
+			{
+				return !(*this == iter);
+			}
+		};
+
+		template<typename TIterator, typename TAccumulate, typename TPredict>
+		class scan_iterator : public iterator_types<scan_iterator<TIterator, TAccumulate, TPredict>, TAccumulate>, private func_holder<TPredict>
+		{
+			typedef scan_iterator<TIterator, TAccumulate, TPredict> TSelf;
+		private:
+			TIterator current_;
+			TIterator end_;
+			TAccumulate accumulate_;
+
+		public:
+			scan_iterator() = default;
+			scan_iterator(const TIterator& current, const TIterator& end, const TAccumulate& init, const TPredict& func)
+				:func_holder<TPredict>(func), current_(current), end_(end), accumulate_(init)
+			{
+				if (current_ != end_)
+				{
+					accumulate_ = this->func()(accumulate_, *current_);
+				}
+			}
+
+			TSelf& operator++()
+			{
+				if (++current_ != end_)
+				{
+					accumulate_ = this->func()(accumulate_, *current_);
+				}
+				return *this;
+			}
+
+			TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++*this;
+				return self;
+			}
+
+			TAccumulate operator*() const
+			{
+				return accumulate_;
+			}
+
+			bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_;
+			}
+
+			bool operator!=(const TSelf& iter) const
+			{
+				return current_ != iter.current_;
+			}
+		};
+
+		template<typename TIterator1, typename TIterator2>
+		class concat_iterator : public iterator_types<concat_iterator<TIterator1, TIterator2>,
+			typename std::conditional<std::is_same<value_type<TIterator1>, value_type<TIterator2>>::value, value_type<TIterator1>, clean_type<value_type<TIterator1>>>::type>
+		{
+			typedef concat_iterator<TIterator1, TIterator2> TSelf;
+			//references only when both sides yield the same reference, a value of the second side is never bound to one
+			using TReference = typename std::conditional<std::is_same<value_type<TIterator1>, value_type<TIterator2>>::value, value_type<TIterator1>, clean_type<value_type<TIterator1>>>::type;
+		private:
+			TIterator1 current1_;
+			TIterator1 end1_;
+			TIterator2 current2_;
+			TIterator2 end2_;
+		public:
+			concat_iterator() = default;
+			constexpr concat_iterator(const TIterator1& current1, const TIterator1& end1, const TIterator2& current2, const TIterator2& end2)
+				:current1_(current1), end1_(end1), current2_(current2), end2_(end2)
+			{
+
+			}
+
+			constexpr TSelf& operator++()
+			{
+				if (current1_ != end1_)
+				{
+					++current1_;
+				}
+				else if (current2_ != end2_)
+				{
+					++current2_;
+				}
+
+				return *this;
+			}
+
+			constexpr TSelf operator++(int)
+			{
+				TSelf self = *this;
+				if (current1_ != end1_)
+				{
+					++current1_;
+				}
+				else if (current2_ != end2_)
+				{
+					++current2_;
+				}
+				return self;
+			}
+
+			constexpr TReference operator*() const
+			{
+				if (current1_ != end1_) return *current1_;
+				return *current2_;
+			}
+
+			constexpr bool operator==(const TSelf& iter) const
+			{
+				if (current1_ != end1_) return current1_ == iter.current1_;
+				return current2_ == iter.current2_;
+			}
+
+			constexpr bool operator!=(const TSelf& iter) const
+			{
+				if (current1_ != end1_) return current1_ != iter.current1_;
+				return current2_ != iter.current2_;
+			}
+		};
+        //TPair is a pair of values, or of std::reference_wrapper for zip_ref
+        template<typename TIterator1, typename TIterator2, typename TPair = std::pair<clean_type<value_type<TIterator1>>, clean_type<value_type<TIterator2>>>>
+        class zip_iterator : public iterator_types<zip_iterator<TIterator1, TIterator2, TPair>, TPair>
+        {
+            typedef zip_iterator<TIterator1, TIterator2, TPair> TSelf;
+        private:
+            TIterator1 current1_;
+            TIterator1 end1_;
+            TIterator2 current2_;
+            TIterator2 end2_;
+
+			//mismatched lengths are reported when the shorter sequence runs out
+			constexpr void check() const
+			{
+				if ((current1_ == end1_) != (current2_ == end2_)) LINQ_THROW("The size of two sequence is not matched.");
+			}
+        public:
+            zip_iterator() = default;
+            constexpr zip_iterator(const TIterator1& current1, const TIterator1& end1, const TIterator2& current2, const TIterator2& end2)
+				:current1_(current1), end1_(end1), current2_(current2), end2_(end2)
+            {
+				check();
+            }
+			constexpr TSelf& operator++()
+			{
+				++current1_;
+				++current2_;
+				check();
+				return *this;
+			}
+
+			constexpr TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++*this;
+				return self;
+			}
+
+			constexpr TPair operator*() const
+			{
+				return TPair(*current1_, *current2_);
+			}
+
+			constexpr bool operator==(const TSelf& iter) const
+			{
+				return current1_ == iter.current1_;
+			}
+
+			constexpr bool operator!=(const TSelf& iter) const
+			{
+				return current1_ != iter.current1_;
+			}
+
+		};
+
+		//chunk, views into random access sources
+		template<typename TIterator, bool = is_random_access<TIterator>::value>
+		class chunk_iterator : public iterator_types<chunk_iterator<TIterator, true>, Queryable<TIterator>>
+		{
+			typedef chunk_iterator<TIterator, true> TSelf;
+		private:
+			TIterator current_;
+			TIterator end_;
+			size_t size_;
+			TIterator next_;
+
+			TIterator next(const TIterator& it) const
+			{
+				auto left = static_cast<size_t>(end_ - it);
+				return it + (size_ < left ? size_ : left);
+			}
+		public:
+			chunk_iterator() = default;
+			chunk_iterator(const TIterator& current, const TIterator& end, size_t size)
+				:current_(current), end_(end), size_(size), next_(next(current))
+			{
+
+			}
+
+			TSelf& operator++()
+			{
+				current_ = next_;
+				next_ = next(current_);
+				return *this;
+			}
+
+			TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++*this;
+				return self;
+			}
+
+			Queryable<TIterator> operator*() const
+			{
+				return Queryable<TIterator>(current_, next_);
+			}
+
+			bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_;
+			}
+
+			bool operator!=(const TSelf& iter) const
+			{
+				return current_ != iter.current_;
+			}
+		};
+
+		//chunk, other sources are buffered, the buffer is reused for every chunk
+		template<typename TIterator>
+		class chunk_iterator<TIterator, false> : public iterator_types<chunk_iterator<TIterator, false>, Queryable<const clean_type<value_type<TIterator>>*>>
+		{
+			typedef chunk_iterator<TIterator, false> TSelf;
+			using TElement = clean_type<value_type<TIterator>>;
+		private:
+			TIterator current_;
+			TIterator end_;
+			size_t size_;
+			std::vector<TElement> buffer_;
+
+			void fill()
+			{
+				buffer_.clear();
+				while (buffer_.size() < size_ && current_ != end_)
+				{
+					buffer_.push_back(*current_);
+					++current_;
+				}
+			}
+		public:
+			chunk_iterator() = default;
+			chunk_iterator(const TIterator& current, const TIterator& end, size_t size)
+				:current_(current), end_(end), size_(size)
+			{
+				if (current_ != end_)
+				{
+					buffer_.reserve(size_);
+					fill();
+				}
+			}
+
+			TSelf& operator++()
+			{
+				fill();
+				return *this;
+			}
+
+			TSelf operator++(int)
+			{
+				TSelf self = *this;
+				fill();
+				return self;
+			}
+
+			//valid until the iterator is advanced
+			Queryable<const TElement*> operator*() const
+			{
+				return Queryable<const TElement*>(buffer_.data(), buffer_.data() + buffer_.size());
+			}
+
+			bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_ && buffer_.size() == iter.buffer_.size();
+			}
+
+			bool operator!=(const TSelf& iter) const
+			{
+				return !(*this == iter);
+			}
+		};
+
+		//sliding window, views into random access sources
+		template<typename TIterator, bool = is_random_access<TIterator>::value>
+		class sliding_window_iterator : public iterator_types<sliding_window_iterator<TIterator, true>, Queryable<TIterator>>
+		{
+			typedef sliding_window_iterator<TIterator, true> TSelf;
+		private:
+			TIterator current_;
+			TIterator end_;
+			size_t size_;
+			size_t step_;
+		public:
+			sliding_window_iterator() = default;
+			sliding_window_iterator(const TIterator& current, const TIterator& end, size_t size, size_t step)
+				:current_(current), end_(end), size_(size), step_(step)
+			{
+				if (static_cast<size_t>(end_ - current_) < size_)
+				{
+					current_ = end_;
+				}
+			}
+
+			TSelf& operator++()
+			{
+				if (static_cast<size_t>(end_ - current_) < step_ + size_)
+				{
+					current_ = end_;
+				}
+				else
+				{
+					current_ += step_;
+				}
+				return *this;
+			}
+
+			TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++*this;
+				return self;
+			}
+
+			Queryable<TIterator> operator*() const
+			{
+				return Queryable<TIterator>(current_, current_ + size_);
+			}
+
+			bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_;
+			}
+
+			bool operator!=(const TSelf& iter) const
+			{
+				return current_ != iter.current_;
+			}
+		};
+
+		//sliding window, other sources are buffered, the buffer is reused for every window
+		template<typename TIterator>
+		class sliding_window_iterator<TIterator, false> : public iterator_types<sliding_window_iterator<TIterator, false>, Queryable<const clean_type<value_type<TIterator>>*>>
+		{
+			typedef sliding_window_iterator<TIterator, false> TSelf;
+			using TElement = clean_type<value_type<TIterator>>;
+		private:
+			TIterator current_;
+			TIterator end_;
+			size_t size_;
+			size_t step_;
+			std::vector<TElement> buffer_;
+
+			void fill()
+			{
+				while (buffer_.size() < size_ && current_ != end_)
+				{
+					buffer_.push_back(*current_);
+					++current_;
+				}
+				//only full windows are yielded
+				if (buffer_.size() < size_)
+				{
+					buffer_.clear();
+				}
+			}
+		public:
+			sliding_window_iterator() = default;
+			sliding_window_iterator(const TIterator& current, const TIterator& end, size_t size, size_t step)
+				:current_(current), end_(end), size_(size), step_(step)
+			{
+				if (current_ != end_)
+				{
+					buffer_.reserve(size_);
+					fill();
+				}
+			}
+
+			TSelf& operator++()
+			{
+				if (step_ < size_)
+				{
+					buffer_.erase(buffer_.begin(), buffer_.begin() + step_);
+				}
+				else
+				{
+					buffer_.clear();
+					for (size_t i = size_; i < step_ && current_ != end_; ++i)
+					{
+						++current_;
+					}
+				}
+				fill();
+				return *this;
+			}
+
+			TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++*this;
+				return self;
+			}
+
+			//valid until the iterator is advanced
+			Queryable<const TElement*> operator*() const
+			{
+				return Queryable<const TElement*>(buffer_.data(), buffer_.data() + buffer_.size());
+			}
+
+			bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_ && buffer_.size() == iter.buffer_.size();
+			}
+
+			bool operator!=(const TSelf& iter) const
+			{
+				return !(*this == iter);
+			}
+		};
+
+		//chunk_by, views into random access sources
+		template<typename TIterator, typename TPredict, bool = is_random_access<TIterator>::value>
+		class chunk_by_iterator : public iterator_types<chunk_by_iterator<TIterator, TPredict, true>, Queryable<TIterator>>, private func_holder<TPredict>
+		{
+			typedef chunk_by_iterator<TIterator, TPredict, true> TSelf;
+		private:
+			TIterator current_;
+			TIterator end_;
+			TIterator next_;
+
+			TIterator next(const TIterator& it) const
+			{
+				if (it == end_) return it;
+				auto prev = it;
+				auto result = it + 1;
+				while (result != end_ && this->func()(*prev, *result))
+				{
+					prev = result;
+					++result;
+				}
+				return result;
+			}
+		public:
+			chunk_by_iterator() = default;
+			chunk_by_iterator(const TIterator& current, const TIterator& end, const TPredict& func)
+				:func_holder<TPredict>(func), current_(current), end_(end), next_(next(current))
+			{
+
+			}
+
+			TSelf& operator++()
+			{
+				current_ = next_;
+				next_ = next(current_);
+				return *this;
+			}
+
+			TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++*this;
+				return self;
+			}
+
+			Queryable<TIterator> operator*() const
+			{
+				return Queryable<TIterator>(current_, next_);
+			}
+
+			bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_;
+			}
+
+			bool operator!=(const TSelf& iter) const
+			{
+				return current_ != iter.current_;
+			}
+		};
+
+		//chunk_by, other sources are buffered, the buffer is reused for every chunk
+		template<typename TIterator, typename TPredict>
+		class chunk_by_iterator<TIterator, TPredict, false> : public iterator_types<chunk_by_iterator<TIterator, TPredict, false>, Queryable<const clean_type<value_type<TIterator>>*>>, private func_holder<TPredict>
+		{
+			typedef chunk_by_iterator<TIterator, TPredict, false> TSelf;
+			using TElement = clean_type<value_type<TIterator>>;
+		private:
+			TIterator current_;
+			TIterator end_;
+			std::vector<TElement> buffer_;
+
+			void fill()
+			{
+				buffer_.clear();
+				if (current_ == end_) return;
+				buffer_.push_back(*current_);
+				while (++current_ != end_ && this->func()(buffer_.back(), *current_))
+				{
+					buffer_.push_back(*current_);
+				}
+			}
+		public:
+			chunk_by_iterator() = default;
+			chunk_by_iterator(const TIterator& current, const TIterator& end, const TPredict& func)
+				:func_holder<TPredict>(func), current_(current), end_(end)
+			{
+				fill();
+			}
+
+			TSelf& operator++()
+			{
+				fill();
+				return *this;
+			}
+
+			TSelf operator++(int)
+			{
+				TSelf self = *this;
+				fill();
+				return self;
+			}
+
+			//valid until the iterator is advanced
+			Queryable<const TElement*> operator*() const
+			{
+				return Queryable<const TElement*>(buffer_.data(), buffer_.data() + buffer_.size());
+			}
+
+			bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_ && buffer_.size() == iter.buffer_.size();
+			}
+
+			bool operator!=(const TSelf& iter) const
+			{
+				return !(*this == iter);
+			}
+		};
+
+		//group_adjacent, runs of equal keys as views into random access sources
+		template<typename TIterator, typename TPredict, bool = is_random_access<TIterator>::value>
+		class group_adjacent_iterator : public iterator_types<group_adjacent_iterator<TIterator, TPredict, true>, std::pair<clean_type<decltype(std::declval<const TPredict&>()(std::declval<value_type<TIterator>>()))>, Queryable<TIterator>>>, private func_holder<TPredict>
+		{
+			typedef group_adjacent_iterator<TIterator, TPredict, true> TSelf;
+			using TKey = clean_type<decltype(std::declval<const TPredict&>()(std::declval<value_type<TIterator>>()))>;
+		private:
+			TIterator current_;
+			TIterator end_;
+			TIterator next_;
+			TKey key_;
+
+			void find_next()
+			{
+				next_ = current_;
+				if (current_ == end_) return;
+				key_ = this->func()(*current_);
+				while (++next_ != end_ && this->func()(*next_) == key_)
+				{
+				}
+			}
+		public:
+			group_adjacent_iterator() = default;
+			group_adjacent_iterator(const TIterator& current, const TIterator& end, const TPredict& func)
+				:func_holder<TPredict>(func), current_(current), end_(end), next_(current), key_()
+			{
+				find_next();
+			}
+
+			TSelf& operator++()
+			{
+				current_ = next_;
+				find_next();
+				return *this;
+			}
+
+			TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++*this;
+				return self;
+			}
+
+			std::pair<TKey, Queryable<TIterator>> operator*() const
+			{
+				return std::pair<TKey, Queryable<TIterator>>(key_, Queryable<TIterator>(current_, next_));
+			}
+
+			bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_;
+			}
+
+			bool operator!=(const TSelf& iter) const
+			{
+				return current_ != iter.current_;
+			}
+		};
+
+		//group_adjacent, other sources buffer one group at a time
+		template<typename TIterator, typename TPredict>
+		class group_adjacent_iterator<TIterator, TPredict, false> : public iterator_types<group_adjacent_iterator<TIterator, TPredict, false>, std::pair<clean_type<decltype(std::declval<const TPredict&>()(std::declval<value_type<TIterator>>()))>, Queryable<const clean_type<value_type<TIterator>>*>>>, private func_holder<TPredict>
+		{
+			typedef group_adjacent_iterator<TIterator, TPredict, false> TSelf;
+			using TElement = clean_type<value_type<TIterator>>;
+			using TKey = clean_type<decltype(std::declval<const TPredict&>()(std::declval<value_type<TIterator>>()))>;
+		private:
+			TIterator current_;
+			TIterator end_;
+			std::vector<TElement> buffer_;
+			TKey key_;
+
+			void fill()
+			{
+				buffer_.clear();
+				if (current_ == end_) return;
+				key_ = this->func()(*current_);
+				buffer_.push_back(*current_);
+				while (++current_ != end_ && this->func()(*current_) == key_)
+				{
+					buffer_.push_back(*current_);
+				}
+			}
+		public:
+			group_adjacent_iterator() = default;
+			group_adjacent_iterator(const TIterator& current, const TIterator& end, const TPredict& func)
+				:func_holder<TPredict>(func), current_(current), end_(end), key_()
+			{
+				fill();
+			}
+
+			TSelf& operator++()
+			{
+				fill();
+				return *this;
+			}
+
+			TSelf operator++(int)
+			{
+				TSelf self = *this;
+				fill();
+				return self;
+			}
+
+			//the group is valid until the iterator is advanced
+			std::pair<TKey, Queryable<const TElement*>> operator*() const
+			{
+				return std::pair<TKey, Queryable<const TElement*>>(key_, Queryable<const TElement*>(buffer_.data(), buffer_.data() + buffer_.size()));
+			}
+
+			bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_ && buffer_.size() == iter.buffer_.size();
+			}
+
+			bool operator!=(const TSelf& iter) const
+			{
+				return !(*this == iter);
+			}
+		};
+
+		//order_by, the source is sorted once on first access and shared by every copy
+		template<typename TIterator, typename TComparer>
+		class ordered_iterator : public iterator_types<ordered_iterator<TIterator, TComparer>, const clean_type<value_type<TIterator>>&>
+		{
+			typedef ordered_iterator<TIterator, TComparer> TSelf;
+			using TElement = clean_type<value_type<TIterator>>;
+		public:
+			class state
+			{
+			private:
+				std::once_flag once_;
+				std::vector<TElement> values_;
+			public:
+				//keeps the first limit elements with a bounded heap, O(n log limit) and O(limit) memory
+				void select_top()
+				{
+					typedef std::pair<TElement, size_t> TItem;
+					auto less = [this](const TItem& a, const TItem& b)
+					{
+						return comparer(a.first, b.first) || (!comparer(b.first, a.first) && a.second < b.second);
+					};
+					std::vector<TItem> heap;
+					heap.reserve(limit);
+					size_t index = 0;
+					for (auto iter = begin; iter != end && limit != 0; ++iter, ++index)
+					{
+						if (heap.size() < limit)
+						{
+							heap.emplace_back(*iter, index);
+							std::push_heap(heap.begin(), heap.end(), less);
+						}
+						else if (comparer(*iter, heap.front().first))
+						{
+							std::pop_heap(heap.begin(), heap.end(), less);
+							heap.back() = TItem(*iter, index);
+							std::push_heap(heap.begin(), heap.end(), less);
+						}
+					}
+					std::sort_heap(heap.begin(), heap.end(), less);
+					values_.reserve(heap.size());
+					for (auto& item : heap)
+					{
+						values_.push_back(std::move(item.first));
+					}
+				}
+			public:
+				TIterator begin;
+				TIterator end;
+				TComparer comparer;
+				size_t concurrency;
+				size_t limit;
+
+				state(const TIterator& begin, const TIterator& end, const TComparer& comparer, size_t concurrency, size_t limit)
+					:begin(begin), end(end), comparer(comparer), concurrency(concurrency), limit(limit)
+				{
+
+				}
+
+				const std::vector<TElement>& values()
+				{
+					std::call_once(once_, [this]()
+					{
+						if (limit != static_cast<size_t>(-1))
+						{
+							select_top();
+						}
+						else
+						{
+							values_.assign(begin, end);
+							parallel::stable_sort(values_, comparer, concurrency);
+						}
+					});
+					return values_;
+				}
+			};
+		private:
+			std::shared_ptr<state> state_;
+			size_t index_;
+			bool end_;
+
+			size_t position() const
+			{
+				return end_ ? state_->values().size() : index_;
+			}
+		public:
+			ordered_iterator() = default;
+			ordered_iterator(const std::shared_ptr<state>& state, bool end)
+				:state_(state), index_(0), end_(end)
+			{
+
+			}
+
+			TSelf& operator++()
+			{
+				++index_;
+				return *this;
+			}
+
+			TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++index_;
+				return self;
+			}
+
+			const TElement& operator*() const
+			{
+				return state_->values()[index_];
+			}
+
+			bool operator==(const TSelf& iter) const
+			{
+				return position() == iter.position();
+			}
+
+			bool operator!=(const TSelf& iter) const
+			{
+				return position() != iter.position();
+			}
+		};
+
+		//order_by with a memory budget, sorted runs are spilled on first access
+		template<typename TIterator, typename TComparer>
+		class external_sort_state
+		{
+		public:
+			typedef clean_type<value_type<TIterator>> element_type;
+		private:
+			std::once_flag once_;
+			spill::run_set<element_type> runs_;
+
+			void spill_runs()
+			{
+				auto& tail = runs_.tail;
+				size_t capacity = std::max<size_t>(1, budget.bytes / sizeof(element_type));
+				for (auto iter = begin; iter != end; ++iter)
+				{
+					if (tail.size() == tail.capacity() && tail.capacity() < capacity)
+					{
+						tail.reserve(std::min(capacity, tail.capacity() * 2 + 1));
+					}
+					tail.push_back(*iter);
+					if (tail.size() == capacity)
+					{
+						std::stable_sort(tail.begin(), tail.end(), comparer);
+						runs_.files.push_back(spill::write_run(tail, budget));
+						tail.clear();
+					}
+				}
+				std::stable_sort(tail.begin(), tail.end(), comparer);
+			}
+		public:
+			TIterator begin;
+			TIterator end;
+			TComparer comparer;
+			memory_budget budget;
+
+			external_sort_state(const TIterator& begin, const TIterator& end, const TComparer& comparer, const memory_budget& budget)
+				:begin(begin), end(end), comparer(comparer), budget(budget)
+			{
+
+			}
+
+			const spill::run_set<element_type>& runs()
+			{
+				std::call_once(once_, [this]() { spill_runs(); });
+				return runs_;
+			}
+		};
+
+		//k-way merge of the sorted runs of TState, every enumeration opens the run files again
+		//copies share the merge until one of them advances, which then reopens the runs at the same position
+		//the element is buffered in the merge, so the iterator is single pass for the C++20 concepts
+		template<typename TState>
+		class run_merge_iterator : public iterator_types<run_merge_iterator<TState>, const typename TState::element_type&, std::input_iterator_tag>
+		{
+			typedef run_merge_iterator<TState> TSelf;
+			using TElement = typename TState::element_type;
+		private:
+			//equal elements come from the earlier run first
+			class merger
+			{
+			private:
+				std::shared_ptr<TState> state_;
+				const spill::run_set<TElement>& runs_;
+				std::vector<spill::file_stream<TElement>> streams_;
+				std::vector<TElement> heads_;
+				std::vector<size_t> heap_;
+				size_t tail_index_;
+				size_t current_;
+				size_t position_;
+
+				bool greater(size_t a, size_t b) const
+				{
+					return state_->comparer(heads_[b], heads_[a]) || (!state_->comparer(heads_[a], heads_[b]) && a > b);
+				}
+
+				void pull(size_t run)
+				{
+					bool more;
+					if (run < streams_.size())
+					{
+						more = streams_[run].read(heads_[run]);
+					}
+					else
+					{
+						more = tail_index_ < runs_.tail.size();
+						if (more) heads_[run] = runs_.tail[tail_index_++];
+					}
+					if (more)
+					{
+						heap_.push_back(run);
+						std::push_heap(heap_.begin(), heap_.end(), [this](size_t a, size_t b) { return greater(a, b); });
+					}
+				}
+
+				void pop()
+				{
+					if (heap_.empty())
+					{
+						current_ = heads_.size();
+						return;
+					}
+					std::pop_heap(heap_.begin(), heap_.end(), [this](size_t a, size_t b) { return greater(a, b); });
+					current_ = heap_.back();
+					heap_.pop_back();
+				}
+			public:
+				merger(const std::shared_ptr<TState>& state)
+					:state_(state), runs_(state->runs()), tail_index_(0), position_(0)
+				{
+					streams_.reserve(runs_.files.size());
+					for (auto& file : runs_.files)
+					{
+						streams_.emplace_back(*file, "rb");
+					}
+					heads_.resize(runs_.files.size() + 1);
+					for (size_t run = 0; run < heads_.size(); ++run)
+					{
+						pull(run);
+					}
+					pop();
+				}
+
+				//reopens the runs of another merge at its read positions
+				merger(const merger& other)
+					:state_(other.state_), runs_(other.runs_), heads_(other.heads_), heap_(other.heap_),
+					tail_index_(other.tail_index_), current_(other.current_), position_(other.position_)
+				{
+					streams_.reserve(runs_.files.size());
+					for (size_t run = 0; run < runs_.files.size(); ++run)
+					{
+						streams_.emplace_back(*runs_.files[run], "rb");
+						streams_.back().seek(other.streams_[run].position());
+					}
+				}
+
+				merger& operator=(const merger&) = delete;
+
+				bool done() const
+				{
+					return current_ == heads_.size();
+				}
+
+				size_t position() const
+				{
+					return position_;
+				}
+
+				const TElement& current() const
+				{
+					return heads_[current_];
+				}
+
+				void next()
+				{
+					pull(current_);
+					pop();
+					++position_;
+				}
+			};
+
+			std::shared_ptr<TState> state_;
+			mutable std::shared_ptr<merger> merger_;
+			bool end_;
+
+			merger& started() const
+			{
+				if (!merger_) merger_ = std::make_shared<merger>(state_);
+				return *merger_;
+			}
+
+			//the merge this iterator may advance without moving its copies
+			merger& owned()
+			{
+				if (merger_ && merger_.use_count() > 1) merger_ = std::make_shared<merger>(*merger_);
+				return started();
+			}
+
+			bool done() const
+			{
+				return end_ || started().done();
+			}
+		public:
+			run_merge_iterator() = default;
+			run_merge_iterator(const std::shared_ptr<TState>& state, bool end)
+				:state_(state), end_(end)
+			{
+
+			}
+
+			TSelf& operator++()
+			{
+				owned().next();
+				return *this;
+			}
+
+			TSelf operator++(int)
+			{
+				TSelf self = *this;
+				owned().next();
+				return self;
+			}
+
+			const TElement& operator*() const
+			{
+				return started().current();
+			}
+
+			bool operator==(const TSelf& iter) const
+			{
+				bool a = done(), b = iter.done();
+				return a || b ? a == b : state_ == iter.state_ && started().position() == iter.started().position();
+			}
+
+			bool operator!=(const TSelf& iter) const
+			{
+				return !(*this == iter);
+			}
+		};
+
+		//distinct of a sorted source, yields the first element of every run of equivalent elements
+		template<typename TIterator, typename TComparer>
+		class unique_iterator : public iterator_types<unique_iterator<TIterator, TComparer>, value_type<TIterator>>, private func_holder<TComparer>
+		{
+			typedef unique_iterator<TIterator, TComparer> TSelf;
+		private:
+			cursor<TIterator> current_;
+		public:
+			unique_iterator() = default;
+			constexpr unique_iterator(const TIterator& current, const TIterator& end, const TComparer& comparer)
+				:func_holder<TComparer>(comparer), current_(current, end)
+			{
+
+			}
+
+			constexpr bool at_end() const
+			{
+				return current_.at_end();
+			}
+
+			constexpr TSelf& operator++()
+			{
+				auto previous = current_;
+				++current_;
+				while (!current_.at_end() && !this->func()(*previous, *current_))
+				{
+					++current_;
+				}
+				return *this;
+			}
+
+			constexpr TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++*this;
+				return self;
+			}
+
+			constexpr auto operator*() const -> decltype(*current_)
+			{
+				return *current_;
+			}
+
+			constexpr bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_;
+			}
+
+			constexpr bool operator!=(const TSelf& iter) const
+			{
+				return current_ != iter.current_;
+			}
+		};
+
+		enum class merge_operation
+		{
+			set_union,
+			set_intersection,
+			set_difference
+		};
+
+		//linq_union, intersect and except of two sources sorted by the same comparer, a linear merge without buffering
+		//equivalent elements are yielded once, like the set based operators
+		template<typename TIterator1, typename TIterator2, typename TComparer, merge_operation Operation>
+		class set_merge_iterator : public iterator_types<set_merge_iterator<TIterator1, TIterator2, TComparer, Operation>,
+			typename std::conditional<std::is_same<value_type<TIterator1>, value_type<TIterator2>>::value, value_type<TIterator1>, clean_type<value_type<TIterator1>>>::type>, private func_holder<TComparer>
+		{
+			typedef set_merge_iterator<TIterator1, TIterator2, TComparer, Operation> TSelf;
+			using TReference = typename std::conditional<std::is_same<value_type<TIterator1>, value_type<TIterator2>>::value, value_type<TIterator1>, clean_type<value_type<TIterator1>>>::type;
+		private:
+			cursor<TIterator1> current1_;
+			cursor<TIterator2> current2_;
+
+			//the second source is current when it is the smaller one
+			constexpr bool second_first() const
+			{
+				return current1_.at_end() || (!current2_.at_end() && this->func()(*current2_, *current1_));
+			}
+
+			template<typename TCursor, typename TPrevious>
+			constexpr void skip(TCursor& current, const TPrevious& previous)
+			{
+				while (!current.at_end() && !this->func()(*previous, *current))
+				{
+					++current;
+				}
+			}
+
+			//moves to the next element the operation yields
+			constexpr void settle()
+			{
+				while (!current1_.at_end() && !current2_.at_end())
+				{
+					if (this->func()(*current2_, *current1_))
+					{
+						++current2_;
+					}
+					else if (Operation == merge_operation::set_intersection && this->func()(*current1_, *current2_))
+					{
+						++current1_;
+					}
+					else if (Operation == merge_operation::set_difference && !this->func()(*current1_, *current2_))
+					{
+						auto previous = current1_;
+						skip(current1_, previous);
+					}
+					else
+					{
+						break;
+					}
+				}
+			}
+		public:
+			set_merge_iterator() = default;
+			constexpr set_merge_iterator(const TIterator1& current1, const TIterator1& end1, const TIterator2& current2, const TIterator2& end2, const TComparer& comparer)
+				:func_holder<TComparer>(comparer), current1_(current1, end1), current2_(current2, end2)
+			{
+				if (Operation != merge_operation::set_union) settle();
+			}
+
+			constexpr bool at_end() const
+			{
+				return Operation == merge_operation::set_union ? current1_.at_end() && current2_.at_end()
+					: Operation == merge_operation::set_intersection ? current1_.at_end() || current2_.at_end()
+					: current1_.at_end();
+			}
+
+			constexpr TSelf& operator++()
+			{
+				if (Operation == merge_operation::set_union && second_first())
+				{
+					auto previous = current2_;
+					skip(current2_, previous);
+					skip(current1_, previous);
+				}
+				else
+				{
+					auto previous = current1_;
+					skip(current1_, previous);
+					skip(current2_, previous);
+					if (Operation != merge_operation::set_union) settle();
+				}
+				return *this;
+			}
+
+			constexpr TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++*this;
+				return self;
+			}
+
+			constexpr TReference operator*() const
+			{
+				if (Operation == merge_operation::set_union && second_first()) return *current2_;
+				return *current1_;
+			}
+
+			constexpr bool operator==(const TSelf& iter) const
+			{
+				bool a = at_end(), b = iter.at_end();
+				return a || b ? a == b : current1_ == iter.current1_ && current2_ == iter.current2_;
+			}
+
+			constexpr bool operator!=(const TSelf& iter) const
+			{
+				return !(*this == iter);
+			}
+		};
+
+		//from_columns, random access over parallel arrays
+		template<typename... TColumns>
+		class column_iterator
+		{
+			typedef column_iterator<TColumns...> TSelf;
+		private:
+			std::tuple<const TColumns*...> columns_;
+			size_t index_;
+		public:
+			typedef std::random_access_iterator_tag iterator_category;
+			typedef column_row<TColumns...> value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const value_type* pointer;
+			typedef value_type reference;
+
+			column_iterator() = default;
+			column_iterator(const std::tuple<const TColumns*...>& columns, size_t index)
+				:columns_(columns), index_(index)
+			{
+
+			}
+
+			template<size_t I>
+			const typename std::tuple_element<I, std::tuple<TColumns...>>::type* column() const
+			{
+				return std::get<I>(columns_) + index_;
+			}
+
+			TSelf& operator++()
+			{
+				++index_;
+				return *this;
+			}
+
+			TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++index_;
+				return self;
+			}
+
+			TSelf& operator--()
+			{
+				--index_;
+				return *this;
+			}
+
+			TSelf operator--(int)
+			{
+				TSelf self = *this;
+				--index_;
+				return self;
+			}
+
+			TSelf& operator+=(difference_type n)
+			{
+				index_ += n;
+				return *this;
+			}
+
+			TSelf& operator-=(difference_type n)
+			{
+				index_ -= n;
+				return *this;
+			}
+
+			TSelf operator+(difference_type n) const
+			{
+				return TSelf(columns_, index_ + n);
+			}
+
+			TSelf operator-(difference_type n) const
+			{
+				return TSelf(columns_, index_ - n);
+			}
+
+			difference_type operator-(const TSelf& iter) const
+			{
+				return static_cast<difference_type>(index_) - static_cast<difference_type>(iter.index_);
+			}
+
+			value_type operator*() const
+			{
+				return value_type(columns_, index_);
+			}
+
+			value_type operator[](difference_type n) const
+			{
+				return value_type(columns_, index_ + n);
+			}
+
+			bool operator==(const TSelf& iter) const
+			{
+				return index_ == iter.index_;
+			}
+
+			bool operator!=(const TSelf& iter) const
+			{
+				return index_ != iter.index_;
+			}
+
+			bool operator<(const TSelf& iter) const
+			{
+				return index_ < iter.index_;
+			}
+		};
+
+		//where over random access arithmetic sources, evaluated a block at a time
+		//the predicate fills a mask without branches and the mask is compacted into a selection vector
+		template<typename TIterator, typename TPredict>
+		class vectorized_where_iterator : public iterator_types<vectorized_where_iterator<TIterator, TPredict>, value_type<TIterator>>, private func_holder<TPredict>
+		{
+			typedef vectorized_where_iterator<TIterator, TPredict> TSelf;
+		public:
+			static const size_t block_size = 1024;
+		private:
+			TIterator begin_;
+			size_t size_;
+			size_t block_;
+			size_t count_;
+			size_t position_;
+			//shared by copies, the one that moves to another block while it is shared takes a buffer of its own
+			std::shared_ptr<std::vector<unsigned short>> selection_;
+
+			size_t block_length() const
+			{
+				return std::min(block_size, size_ - block_);
+			}
+
+			//finds the next block with at least one selected value
+			void fill()
+			{
+				position_ = 0;
+				count_ = 0;
+				if (block_ >= size_) return;
+				if (!selection_ || selection_.use_count() > 1)
+				{
+					selection_ = std::make_shared<std::vector<unsigned short>>(block_size);
+				}
+				auto& selection = *selection_;
+				unsigned char mask[block_size];
+				while (block_ < size_)
+				{
+					auto first = begin_ + block_;
+					size_t length = block_length();
+					for (size_t i = 0; i < length; ++i)
+					{
+						mask[i] = this->func()(first[i]) ? 1 : 0;
+					}
+					size_t count = 0;
+					for (size_t i = 0; i < length; ++i)
+					{
+						selection[count] = static_cast<unsigned short>(i);
+						count += mask[i];
+					}
+					if (count != 0)
+					{
+						count_ = count;
+						return;
+					}
+					block_ += length;
+				}
+			}
+
+			size_t index() const
+			{
+				return block_ >= size_ ? size_ : block_ + (*selection_)[position_];
+			}
+
+		public:
+			vectorized_where_iterator() = default;
+			vectorized_where_iterator(const TIterator& begin, size_t size, size_t block, const TPredict& func)
+				:func_holder<TPredict>(func), begin_(begin), size_(size), block_(block), count_(0), position_(0)
+			{
+				fill();
+			}
+
+			//counts the remaining values from the masks only, no selection vector is built
+			size_t count_to(const TSelf& end) const
+			{
+				if (block_ >= end.block_) return 0;
+				size_t cnt = count_ - position_;
+				for (size_t lo = block_ + block_length(); lo < size_; lo += block_size)
+				{
+					auto first = begin_ + lo;
+					size_t length = std::min(block_size, size_ - lo);
+					size_t count = 0;
+					for (size_t i = 0; i < length; ++i)
+					{
+						count += this->func()(first[i]) ? 1 : 0;
+					}
+					cnt += count;
+				}
+				return cnt;
+			}
+
+			TSelf& operator++()
+			{
+				if (++position_ == count_)
+				{
+					block_ += block_length();
+					fill();
+				}
+				return *this;
+			}
+
+			TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++*this;
+				return self;
+			}
+
+			auto operator*() const -> decltype(begin_[0])
+			{
+				return begin_[block_ + (*selection_)[position_]];
+			}
+
+			bool operator==(const TSelf& iter) const
+			{
+				return index() == iter.index();
+			}
+
+			bool operator!=(const TSelf& iter) const
+			{
+				return index() != iter.index();
+			}
+		};
+
+		template<typename TIterator, typename TPredict>
+		const size_t vectorized_where_iterator<TIterator, TPredict>::block_size;
+
+		template<typename TContainerPointer>
+		class adapter_iterator : public iterator_types<adapter_iterator<TContainerPointer>, decltype(*std::declval<TContainerPointer&>()->begin())>
+		{
+			typedef adapter_iterator<TContainerPointer> TSelf;
+		private:
+			TContainerPointer p_;
+			using TContainerIterator = decltype(p_->begin());
+			TContainerIterator current_;
+			TContainerIterator end_;
+
+		public:
+			adapter_iterator() = default;
+			adapter_iterator(const TContainerPointer& p, const TContainerIterator& current, const TContainerIterator& end)
+				:p_(p), current_(current), end_(end)
+			{
+
+			}
+
+			TSelf& operator++()
+			{
+				++current_;
+				return *this;
+			}
+
+			TSelf operator++(int)
+			{
+				TSelf self = *this;
+				++current_;
+				return self;
+			}
+
+			auto operator*() const -> decltype(*current_)
+			{
+				return *current_;
+			}
+
+			bool operator==(const TSelf& iter) const
+			{
+				return current_ == iter.current_;
+			}
+
+			bool operator!=(const TSelf& iter) const
+			{
+				return current_ != iter.current_;
+			}
+		};
+	}
+
+	namespace iterators
+	{
+		template<typename TIterator, typename TPredict>
+		using where_iter = where_iterator<TIterator, TPredict>;
+
+		template<typename TIterator, typename TPredict>
+		using select_iter = select_iterator<TIterator, TPredict>;
+
+		template<typename TIterator, typename TPredict>
+		using single_iter = single_iterator<TIterator, TPredict>;
+
+		template<typename TIterator>
+		using skip_iter = skip_iterator<TIterator>;
+
+		template<typename TIterator, typename TPredict>
+		using skip_while_iter = skip_while_iterator<TIterator, TPredict>;
+
+		template<typename TIterator>
+		using take_iter = take_iterator<TIterator>;
+
+		template<typename TIterator, typename TPredict>
+		using take_while_iter = take_while_iterator<TIterator, TPredict>;
+
+		template<typename TIterator1, typename TIterator2>
+		using concat_iter = concat_iterator<TIterator1, TIterator2>;
+
+		template<typename TIterator, typename TAccumulate, typename TPredict>
+		using scan_iter = scan_iterator<TIterator, TAccumulate, TPredict>;
+
+		template<typename TIterator, typename TPredict>
+		using vectorized_where_iter = vectorized_where_iterator<TIterator, TPredict>;
+
+		template<typename TContainerPointer>
+		using adapter_iter = adapter_iterator<TContainerPointer>;
+
+		template<typename TIterator1, typename TIterator2>
+		using zip_iter = zip_iterator<TIterator1, TIterator2>;
+
+		template<typename TIterator1, typename TIterator2>
+		using zip_ref_iter = zip_iterator<TIterator1, TIterator2,
+			std::pair<std::reference_wrapper<const clean_type<value_type<TIterator1>>>, std::reference_wrapper<const clean_type<value_type<TIterator2>>>>>;
+
+		template<typename TIterator>
+		using chunk_iter = chunk_iterator<TIterator>;
+
+		template<typename TIterator>
+		using sliding_window_iter = sliding_window_iterator<TIterator>;
+
+		template<typename TIterator, typename TPredict>
+		using chunk_by_iter = chunk_by_iterator<TIterator, TPredict>;
+
+		template<typename TIterator, typename TPredict>
+		using group_adjacent_iter = group_adjacent_iterator<TIterator, TPredict>;
+
+        template<typename TIterator>
+        using any_type_iter = any_type_iterator<TIterator>;
+
+        template<typename TIterator>
+        using empty_iter = empty_iterator<TIterator>;
+
+		template<typename TIterator, typename TComparer>
+		using ordered_iter = ordered_iterator<TIterator, TComparer>;
+
+		template<typename TIterator, typename TComparer>
+		using external_merge_iter = run_merge_iterator<external_sort_state<TIterator, TComparer>>;
+
+		template<typename T, typename TComparer>
+		using spilled_iter = run_merge_iterator<spill::sorted_runs<T, TComparer>>;
+
+		template<typename TIterator, typename TComparer>
+		using unique_iter = unique_iterator<TIterator, TComparer>;
+
+		template<typename TIterator1, typename TIterator2, typename TComparer, merge_operation Operation>
+		using set_merge_iter = set_merge_iterator<TIterator1, TIterator2, TComparer, Operation>;
+
+		template<typename... TColumns>
+		using column_iter = column_iterator<TColumns...>;
+	}
+
+	template<typename TIterator, typename TPredict>
+	struct stable_reference<iterators::where_iterator<TIterator, TPredict>> : stable_reference<TIterator> {};
+
+	template<typename TIterator>
+	struct stable_reference<iterators::skip_iterator<TIterator>> : stable_reference<TIterator> {};
+
+	template<typename TIterator, typename TPredict>
+	struct stable_reference<iterators::skip_while_iterator<TIterator, TPredict>> : stable_reference<TIterator> {};
+
+	template<typename TIterator>
+	struct stable_reference<iterators::take_iterator<TIterator>> : stable_reference<TIterator> {};
+
+	template<typename TIterator, typename TPredict>
+	struct stable_reference<iterators::take_while_iterator<TIterator, TPredict>> : stable_reference<TIterator> {};
+
+	template<typename TIterator, typename TComparer>
+	struct stable_reference<iterators::unique_iterator<TIterator, TComparer>> : stable_reference<TIterator> {};
+
+	//linq<const T&> only adapts stable sources
+	template<typename T>
+	struct stable_reference<iterators::any_type_iterator<T>> : std::is_lvalue_reference<T> {};
+
+    template<typename T>
+    class linq : public Queryable<iterators::any_type_iter<T>>
+    {
+    public:
+        linq() = default;
+
+        template<typename TIterator>
+        linq(const Queryable<TIterator>& e)
+            :Queryable<iterators::any_type_iter<T>>(
+            iterators::any_type_iter<T>(e.begin()),
+            iterators::any_type_iter<T>(e.end())
+            )
+        {
+        }
+    };
+
+	template <typename TIterator>
+	constexpr Queryable<TIterator> from(const TIterator& begin, const TIterator& end)
+	{
+		return Queryable<TIterator>(begin, end);
+	}
+
+	template<typename TContainer>
+	constexpr auto from(const TContainer &container) -> decltype(Queryable<decltype(std::begin(container))>(std::begin(container), std::end(container)))
+	{
+		return Queryable<decltype(std::begin(container))>(std::begin(container), std::end(container));
+	}
+
+    template<typename T>
+    constexpr auto from(const std::initializer_list<T> &list) -> decltype(Queryable<decltype(std::begin(list))>(std::begin(list), std::end(list)))
+    {
+        return Queryable<decltype(std::begin(list))>(std::begin(list), std::end(list));
+    }
+
+#ifdef __cpp_lib_ranges
+	//ranges that cannot be iterated safely from a const reference are kept alive by the query,
+	//a common view gives begin and end the same type
+	template<typename TRange>
+		requires std::ranges::viewable_range<TRange> && (!std::is_base_of_v<queryable_base, std::remove_cvref_t<TRange>>)
+			&& (!std::ranges::borrowed_range<TRange> || !std::ranges::common_range<const std::remove_cvref_t<TRange>>)
+	auto from(TRange&& range)
+	{
+		typedef decltype(std::views::common(std::forward<TRange>(range))) TView;
+		auto p = std::make_shared<TView>(std::views::common(std::forward<TRange>(range)));
+		return Queryable<iterators::adapter_iter<std::shared_ptr<TView>>>(
+			iterators::adapter_iter<std::shared_ptr<TView>>(p, p->begin(), p->end()),
+			iterators::adapter_iter<std::shared_ptr<TView>>(p, p->end(), p->end())
+			);
+	}
+#endif
+
+	//pipeable operators, from(xs) | views::where(f) | views::select(g)
+	namespace views
+	{
+		template<typename TFunc>
+		class closure
+		{
+		private:
+			TFunc func_;
+		public:
+			closure(const TFunc& func)
+				:func_(func)
+			{
+
+			}
+
+			template<typename TQuery, typename std::enable_if<std::is_base_of<queryable_base, clean_type<TQuery>>::value, int>::type = 0>
+			auto operator()(const TQuery& query) const -> decltype(func_(query))
+			{
+				return func_(query);
+			}
+
+			//other sources go through from()
+			template<typename TSource, typename std::enable_if<!std::is_base_of<queryable_base, clean_type<TSource>>::value, int>::type = 0>
+			auto operator()(TSource&& source) const -> decltype(func_(from(std::forward<TSource>(source))))
+			{
+				return func_(from(std::forward<TSource>(source)));
+			}
+		};
+
+		template<typename TFunc>
+		closure<TFunc> make_closure(const TFunc& func)
+		{
+			return closure<TFunc>(func);
+		}
+
+		template<typename TSource, typename TFunc>
+		auto operator|(TSource&& source, const closure<TFunc>& op) -> decltype(op(std::forward<TSource>(source)))
+		{
+			return op(std::forward<TSource>(source));
+		}
+
+		template<typename TPredict>
+		auto where(const TPredict& func)
+		{
+			return make_closure([func](const auto& query){ return query.where(func); });
+		}
+
+		template<typename TPredict>
+		auto select(const TPredict& func)
+		{
+			return make_closure([func](const auto& query){ return query.select(func); });
+		}
+
+		inline auto skip(size_t count)
+		{
+			return make_closure([count](const auto& query){ return query.skip(count); });
+		}
+
+		inline auto take(size_t count)
+		{
+			return make_closure([count](const auto& query){ return query.take(count); });
+		}
+
+		template<typename TPredict>
+		auto skip_while(const TPredict& func)
+		{
+			return make_closure([func](const auto& query){ return query.skip_while(func); });
+		}
+
+		template<typename TPredict>
+		auto take_while(const TPredict& func)
+		{
+			return make_closure([func](const auto& query){ return query.take_while(func); });
+		}
+
+		inline auto chunk(size_t size)
+		{
+			return make_closure([size](const auto& query){ return query.chunk(size); });
+		}
+
+		template<typename TPredict>
+		auto order_by(const TPredict& keySelector)
+		{
+			return make_closure([keySelector](const auto& query){ return query.order_by(keySelector); });
+		}
+
+		template<typename TPredict>
+		auto order_by_descending(const TPredict& keySelector)
+		{
+			return make_closure([keySelector](const auto& query){ return query.order_by_descending(keySelector); });
+		}
+	}
+
+    template<typename TContainer>
+    constexpr auto from_values(const TContainer &container)
+    {
+        using TEle = clean_type<decltype(*std::begin(container))>;
+        std::shared_ptr<std::vector<TEle>> p = std::make_shared<std::vector<TEle>>(std::begin(container), std::end(container));
+        return Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TEle>>>>(
+                iterators::adapter_iter<std::shared_ptr<std::vector<TEle>>>(p, p->begin(), p->end()),
+                iterators::adapter_iter<std::shared_ptr<std::vector<TEle>>>(p, p->end(), p->end())
+                );
+    }
+
+    template<typename T>
+    constexpr auto from_values(const std::initializer_list<T> &list)
+    {
+        using TEle = clean_type<decltype(*std::begin(list))>;
+        std::shared_ptr<std::vector<TEle>> p = std::make_shared<std::vector<TEle>>(std::begin(list), std::end(list));
+        return Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TEle>>>>(
+                iterators::adapter_iter<std::shared_ptr<std::vector<TEle>>>(p, p->begin(), p->end()),
+                iterators::adapter_iter<std::shared_ptr<std::vector<TEle>>>(p, p->end(), p->end())
+                );
+    }
+
+    template<typename T>
+    auto from_values(std::vector<T>&& values)
+    {
+        std::shared_ptr<std::vector<T>> p = std::make_shared<std::vector<T>>(std::move(values));
+        return Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<T>>>>(
+                iterators::adapter_iter<std::shared_ptr<std::vector<T>>>(p, p->begin(), p->end()),
+                iterators::adapter_iter<std::shared_ptr<std::vector<T>>>(p, p->end(), p->end())
+                );
+    }
+
+    template<typename TElement>
+	linq<TElement> from_empty()
+	{
+		return Queryable<iterators::empty_iter<TElement>>(
+			iterators::empty_iter<TElement>(),
+			iterators::empty_iter<TElement>()
+			);
+	}
+
+	template<typename T, size_t N>
+	const T* column_data(const T (&column)[N])
+	{
+		return column;
+	}
+
+	template<typename TColumn>
+	auto column_data(const TColumn& column) -> decltype(column.data())
+	{
+		return column.data();
+	}
+
+	//struct of arrays source, every column should have the same length
+	template<typename TColumn, typename... TColumns>
+	auto from_columns(const TColumn& first, const TColumns&... rest)
+		-> Queryable<iterators::column_iter<clean_type<decltype(*column_data(first))>, clean_type<decltype(*column_data(rest))>...>>
+	{
+		typedef iterators::column_iter<clean_type<decltype(*column_data(first))>, clean_type<decltype(*column_data(rest))>...> TIterator;
+		size_t size = static_cast<size_t>(std::end(first) - std::begin(first));
+		size_t sizes[] = { size, static_cast<size_t>(std::end(rest) - std::begin(rest))... };
+		for (auto s : sizes)
+		{
+			if (s != size) LINQ_THROW("The size of columns is not matched.");
+		}
+		auto columns = std::make_tuple(column_data(first), column_data(rest)...);
+		return Queryable<TIterator>(TIterator(columns, 0), TIterator(columns, size));
+	}
+
+	//projection of a single column, from_columns sources yield the column without building rows
+	template<size_t I, typename TIterator>
+	Queryable<iterators::select_iter<TIterator, column<I>>> select_column(const TIterator& begin, const TIterator& end, const column<I>& func)
+	{
+		return Queryable<iterators::select_iter<TIterator, column<I>>>(
+			iterators::select_iter<TIterator, column<I>>(begin, end, func),
+			iterators::select_iter<TIterator, column<I>>(end, end, func)
+			);
+	}
+
+	template<size_t I, typename... TColumns>
+	Queryable<const typename std::tuple_element<I, std::tuple<TColumns...>>::type*> select_column(
+		const iterators::column_iter<TColumns...>& begin, const iterators::column_iter<TColumns...>& end, const column<I>&)
+	{
+		return Queryable<const typename std::tuple_element<I, std::tuple<TColumns...>>::type*>(begin.template column<I>(), end.template column<I>());
+	}
+
+	//rewrites applied while a query is composed, the resulting iterator type depends on the source
+	//count, random access sources are measured and select is counted through its source
+	template<typename TIterator>
+	constexpr size_t count_range(const TIterator& first, const TIterator& last, std::true_type)
+	{
+		return static_cast<size_t>(last - first);
+	}
+
+	template<typename TIterator>
+	constexpr size_t count_range(TIterator first, const TIterator& last, std::false_type)
+	{
+		size_t cnt = 0;
+		for (; first != last; ++first)
+		{
+			++cnt;
+		}
+		return cnt;
+	}
+
+	template<typename TIterator>
+	constexpr size_t count_range(const TIterator& first, const TIterator& last)
+	{
+		return count_range(first, last, is_random_access<TIterator>());
+	}
+
+	template<typename TIterator, typename TPredict>
+	constexpr size_t count_range(const iterators::select_iter<TIterator, TPredict>& first, const iterators::select_iter<TIterator, TPredict>& last)
+	{
+		return count_range(first.base(), last.base());
+	}
+
+	template<typename TIterator, typename TPredict>
+	size_t count_range(const iterators::vectorized_where_iter<TIterator, TPredict>& first, const iterators::vectorized_where_iter<TIterator, TPredict>& last)
+	{
+		return first.count_to(last);
+	}
+
+	//where, adjacent filters are merged into one
+	template<typename TIterator, typename TPredict>
+	constexpr Queryable<iterators::where_iter<TIterator, TPredict>> where_range(const TIterator& first, const TIterator& last, const TPredict& func)
+	{
+		return Queryable<iterators::where_iter<TIterator, TPredict>>(
+			iterators::where_iter<TIterator, TPredict>(first, last, func),
+			iterators::where_iter<TIterator, TPredict>(last, last, func)
+			);
+	}
+
+	template<typename TIterator, typename TPredict1, typename TPredict2>
+	constexpr Queryable<iterators::where_iter<TIterator, and_predicate<TPredict1, TPredict2>>> where_range(
+		const iterators::where_iter<TIterator, TPredict1>& first, const iterators::where_iter<TIterator, TPredict1>& last, const TPredict2& func)
+	{
+		return where_range(first.base(), last.base(), and_predicate<TPredict1, TPredict2>(first.predicate(), func));
+	}
+
+	//skip, random access sources are sliced and nested skips are flattened
+	template<typename TIterator>
+	constexpr Queryable<TIterator> skip_range(const TIterator& first, const TIterator& last, size_t count, std::true_type)
+	{
+		return Queryable<TIterator>(first + static_cast<typename std::iterator_traits<TIterator>::difference_type>(std::min(count, count_range(first, last))), last);
+	}
+
+	template<typename TIterator>
+	constexpr Queryable<iterators::skip_iter<TIterator>> skip_range(const TIterator& first, const TIterator& last, size_t count, std::false_type)
+	{
+		return Queryable<iterators::skip_iter<TIterator>>(
+			iterators::skip_iter<TIterator>(first, last, count),
+			iterators::skip_iter<TIterator>(last, last, count)
+			);
+	}
+
+	template<typename TIterator>
+	constexpr auto skip_range(const TIterator& first, const TIterator& last, size_t count)
+		-> decltype(skip_range(first, last, count, is_random_access<TIterator>()))
+	{
+		return skip_range(first, last, count, is_random_access<TIterator>());
+	}
+
+	template<typename TIterator>
+	constexpr Queryable<iterators::skip_iter<TIterator>> skip_range(const iterators::skip_iter<TIterator>& first, const iterators::skip_iter<TIterator>& last, size_t count)
+	{
+		return skip_range(first.base(), last.base(), count, std::false_type());
+	}
+
+	//take, random access sources are sliced and nested takes keep the smaller count
+	template<typename TIterator>
+	constexpr Queryable<TIterator> take_range(const TIterator& first, const TIterator& last, size_t count, std::true_type)
+	{
+		return Queryable<TIterator>(first, first + static_cast<typename std::iterator_traits<TIterator>::difference_type>(std::min(count, count_range(first, last))));
+	}
+
+	template<typename TIterator>
+	constexpr Queryable<iterators::take_iter<TIterator>> take_range(const TIterator& first, const TIterator& last, size_t count, std::false_type)
+	{
+		return Queryable<iterators::take_iter<TIterator>>(
+			iterators::take_iter<TIterator>(first, last, count),
+			iterators::take_iter<TIterator>(last, last, count)
+			);
+	}
+
+	template<typename TIterator>
+	constexpr auto take_range(const TIterator& first, const TIterator& last, size_t count)
+		-> decltype(take_range(first, last, count, is_random_access<TIterator>()))
+	{
+		return take_range(first, last, count, is_random_access<TIterator>());
+	}
+
+	template<typename TIterator>
+	constexpr Queryable<iterators::take_iter<TIterator>> take_range(const iterators::take_iter<TIterator>& first, const iterators::take_iter<TIterator>& last, size_t count)
+	{
+		return take_range(first.base(), last.base(), std::min(count, first.remaining()), std::false_type());
+	}
+
+	template<typename TIterator>
+	class Queryable : public queryable_base
+	{
+		using TSelf = Queryable<TIterator>;
+		using TElement = clean_type<value_type<TIterator>>;
+		//what first, last, single and element_at return, a reference into stable sources and a copy otherwise
+		using TResult = typename std::conditional<stable_reference<TIterator>::value, const TElement&, TElement>::type;
+		template<typename> friend class Queryable;
+	private:
+		TIterator begin_;
+		TIterator end_;
+
+		//last element of a non empty source, stable sources keep positions and the others keep values
+		TResult last_element(std::true_type) const
+		{
+			return *last_position(is_random_access<TIterator>());
+		}
+		TResult last_element(std::false_type) const
+		{
+			auto iter = begin_;
+			TElement last = *iter;
+			while (++iter != end_)
+			{
+				last = *iter;
+			}
+			return last;
+		}
+		TIterator last_position(std::true_type) const
+		{
+			return end_ - 1;
+		}
+		TIterator last_position(std::false_type) const
+		{
+			auto last = begin_;
+			for (auto iter = begin_; ++iter != end_;)
+			{
+				last = iter;
+			}
+			return last;
+		}
+		template<typename TPredict>
+		TResult last_match(const TPredict& func, std::true_type) const
+		{
+			auto found = end_;
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				if (func(*iter)) found = iter;
+			}
+			if (found == end_) LINQ_THROW("Not found");
+			return *found;
+		}
+		template<typename TPredict>
+		TResult last_match(const TPredict& func, std::false_type) const
+		{
+			std::unique_ptr<TElement> found;
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				if (!func(*iter)) continue;
+				if (found) *found = *iter;
+				else found.reset(new TElement(*iter));
+			}
+			if (!found) LINQ_THROW("Not found");
+			return std::move(*found);
+		}
+
+		//calls func with random access iterators, other sources are copied into a vector first
+		template<typename TFunc>
+		auto with_random_access(const TFunc& func, std::true_type) const -> decltype(func(begin_, end_))
+		{
+			return func(begin_, end_);
+		}
+		template<typename TFunc>
+		auto with_random_access(const TFunc& func, std::false_type) const -> decltype(func(std::vector<TElement>().cbegin(), std::vector<TElement>().cend()))
+		{
+			auto values = to_vector();
+			return func(values.cbegin(), values.cend());
+		}
+		template<typename TFunc>
+		auto with_random_access(const TFunc& func) const -> decltype(with_random_access(func, is_random_access<TIterator>()))
+		{
+			return with_random_access(func, is_random_access<TIterator>());
+		}
+
+		template<typename TComparer>
+		Queryable<iterators::external_merge_iter<TIterator, TComparer>> external_sort(const TComparer& comparer, const memory_budget& budget) const
+		{
+			typedef iterators::external_merge_iter<TIterator, TComparer> TMerge;
+			auto state = std::make_shared<iterators::external_sort_state<TIterator, TComparer>>(begin_, end_, comparer, budget);
+			return Queryable<TMerge>(TMerge(state, false), TMerge(state, true));
+		}
+
+		template<typename T, typename TComparer>
+		static Queryable<iterators::spilled_iter<T, TComparer>> merge_runs(spill::run_set<T>&& runs, const TComparer& comparer)
+		{
+			typedef iterators::spilled_iter<T, TComparer> TMerge;
+			auto state = std::make_shared<spill::sorted_runs<T, TComparer>>(std::move(runs), comparer);
+			return Queryable<TMerge>(TMerge(state, false), TMerge(state, true));
+		}
+
+		template<typename TWriter, typename TSerializer>
+		size_t write_to(TWriter& writer, const TSerializer& serializer) const
+		{
+			size_t count = write_to(writer, serializer, std::integral_constant<bool, std::is_same<TSerializer, io::default_serializer>::value
+				&& std::is_trivially_copyable<TElement>::value && is_contiguous<TIterator>::value>());
+			writer.close();
+			return count;
+		}
+		template<typename TWriter, typename TSerializer>
+		size_t write_to(TWriter& writer, const TSerializer& serializer, std::false_type) const
+		{
+			size_t count = 0;
+			for (auto iter = begin_; iter != end_; ++iter, ++count)
+			{
+				serializer(writer, *iter);
+			}
+			return count;
+		}
+		//raw bytes of a contiguous source in one write
+		template<typename TWriter, typename TSerializer>
+		size_t write_to(TWriter& writer, const TSerializer&, std::true_type) const
+		{
+			size_t count = static_cast<size_t>(end_ - begin_);
+			if (count != 0) writer.write(std::addressof(*begin_), count * sizeof(TElement));
+			return count;
+		}
+
+		//calls func with every element, the source of the spilling operators
+		auto visitor() const
+		{
+			auto first = begin_;
+			auto last = end_;
+			return [first, last](const auto& func)
+			{
+				for (auto iter = first; iter != last; ++iter)
+				{
+					func(*iter);
+				}
+			};
+		}
+	public:
+		constexpr Queryable() = default;
+		constexpr Queryable(const TIterator& begin, const TIterator& end)
+			:begin_(begin), end_(end){}
+
+		constexpr TIterator begin() const
+		{
+			return begin_;
+		}
+
+		constexpr TIterator end() const
+		{
+			return end_;
+		}
+
+		//where
+		template<typename TPredict>
+		constexpr auto where(const TPredict& func) const -> decltype(where_range(begin_, end_, func))
+		{
+			return where_range(begin_, end_, func);
+		}
+		//where over a random access source of arithmetic values, filtered a block at a time
+		template<typename TPredict>
+		Queryable<iterators::vectorized_where_iter<TIterator, TPredict>> where_vectorized(const TPredict& func) const
+		{
+			static_assert(is_random_access<TIterator>::value, "where_vectorized needs a random access source.");
+			static_assert(std::is_arithmetic<TElement>::value, "where_vectorized needs arithmetic values.");
+			size_t size = static_cast<size_t>(end_ - begin_);
+			return Queryable<iterators::vectorized_where_iter<TIterator, TPredict>>(
+				iterators::vectorized_where_iter<TIterator, TPredict>(begin_, size, 0, func),
+				iterators::vectorized_where_iter<TIterator, TPredict>(begin_, size, size, func)
+				);
+		}
+		//select
+		template<typename TPredict>
+		constexpr Queryable<iterators::select_iter<TIterator, TPredict>> select(const TPredict& func) const
+		{
+			return Queryable<iterators::select_iter<TIterator, TPredict>>(
+				iterators::select_iter<TIterator, TPredict>(begin_, end_, func),
+				iterators::select_iter<TIterator, TPredict>(end_, end_, func)
+				);
+		}
+		//select a column
+		template<size_t I>
+		auto select(const column<I>& func) const -> decltype(select_column(begin_, end_, func))
+		{
+			return select_column(begin_, end_, func);
+		}
+        //select_many
+        template<typename TPredict>
+        auto select_many(const TPredict& func) const ->linq<clean_type<decltype(*func(std::declval<TElement&>()).begin())>>
+        {
+            typedef decltype(func(std::declval<TElement&>())) TCollection;
+            typedef clean_type<decltype(*func(std::declval<TElement&>()).begin())> TValue;
+            typedef iterators::adapter_iter<std::shared_ptr<std::vector<TValue>>> TAdapter;
+            return select(func).aggregate(from_empty<TValue>(), [](const linq<TValue> &e1, const TCollection &e2)
+            {
+                //the collection returned by func is a temporary, keep a copy alive
+                auto p = std::make_shared<std::vector<TValue>>();
+                for (auto iter = std::begin(e2); iter != std::end(e2); ++iter)
+                {
+                    p->push_back(*iter);
+                }
+                return linq<TValue>(e1.concat(Queryable<TAdapter>(TAdapter(p, p->begin(), p->end()), TAdapter(p, p->end(), p->end()))));
+            });
+        }
+		//select_many in parallel, the source is split into many more tasks than threads so uneven collections are balanced
+		//by work stealing, the result keeps the source order
+		template<typename TPredict>
+		auto select_many(const execution::parallel_policy& policy, const TPredict& func) const -> linq<clean_type<decltype(*func(std::declval<TElement&>()).begin())>>
+		{
+			typedef clean_type<decltype(*func(std::declval<TElement&>()).begin())> TValue;
+			typedef iterators::adapter_iter<std::shared_ptr<std::vector<TValue>>> TAdapter;
+			const size_t tasks_per_thread = 16;
+			size_t concurrency = parallel::concurrency(policy);
+			auto p = std::make_shared<std::vector<TValue>>();
+			with_random_access([&](auto first, auto last)
+			{
+				size_t size = static_cast<size_t>(last - first);
+				size_t tasks = std::min(size, concurrency * tasks_per_thread);
+				std::vector<std::vector<TValue>> outputs(tasks);
+				//small tasks balance uneven collections, only concurrency of them run at once
+				parallel::for_each_task(tasks, concurrency, [&](size_t task)
+				{
+					size_t lo = size * task / tasks;
+					size_t hi = size * (task + 1) / tasks;
+					for (size_t i = lo; i < hi; ++i)
+					{
+						auto&& collection = func(first[i]);
+						for (auto iter = std::begin(collection); iter != std::end(collection); ++iter)
+						{
+							outputs[task].push_back(*iter);
+						}
+					}
+				});
+				for (auto& output : outputs)
+				{
+					std::move(output.begin(), output.end(), std::back_inserter(*p));
+				}
+			});
+			return linq<TValue>(Queryable<TAdapter>(TAdapter(p, p->begin(), p->end()), TAdapter(p, p->end(), p->end())));
+		}
+		//single without parameter
+		TResult single() const
+		{
+			auto it = begin_;
+			if (++it != end_) LINQ_THROW("The collection should have only one value.");
+			return *begin_;
+		}
+		//single with parameter, keeps the position of the match instead of a copy
+		template<typename TPredict>
+		TResult single(const TPredict& func) const
+		{
+			if (empty()) LINQ_THROW("Empty collection.");
+			auto found = end_;
+			for (auto it = begin_; it != end_; ++it)
+			{
+				if (func(*it))
+				{
+					if (found != end_) LINQ_THROW("More than one value found");
+					found = it;
+				}
+			}
+			if (found == end_) LINQ_THROW("No value found");
+			return *found;
+		}
+		//single_or_default without parameter
+		TElement single_or_default() const
+		{
+			auto it = begin_;
+			//empty
+			if (it == end_) return TElement{};
+
+			if (++it != end_) LINQ_THROW("The collection should have only one value.");
+			return *begin_;
+		}
+		//skip
+		constexpr auto skip(size_t count) const -> decltype(skip_range(begin_, end_, count))
+		{
+			return skip_range(begin_, end_, count);
+		}
+		//skip_while
+		template<typename TPredict>
+		constexpr Queryable<iterators::skip_while_iter<TIterator, TPredict>> skip_while(const TPredict& func) const
+		{
+			return Queryable<iterators::skip_while_iter<TIterator, TPredict>>(
+				iterators::skip_while_iter<TIterator, TPredict>(begin_, end_, func),
+				iterators::skip_while_iter<TIterator, TPredict>(end_, end_, func)
+				);
+		}
+		//take
+		constexpr auto take(size_t count) const -> decltype(take_range(begin_, end_, count))
+		{
+			return take_range(begin_, end_, count);
+		}
+		//take_while
+		template<typename TPredict>
+		constexpr Queryable<iterators::take_while_iter<TIterator, TPredict>> take_while(const TPredict& func) const
+		{
+			return Queryable<iterators::take_while_iter<TIterator, TPredict>>(
+				iterators::take_while_iter<TIterator, TPredict>(begin_, end_, func),
+				iterators::take_while_iter<TIterator, TPredict>(end_, end_, func)
+				);
+		}
+		//chunk
+		Queryable<iterators::chunk_iter<TIterator>> chunk(size_t size) const
+		{
+			if (size == 0) LINQ_THROW("The chunk size should be positive.");
+			return Queryable<iterators::chunk_iter<TIterator>>(
+				iterators::chunk_iter<TIterator>(begin_, end_, size),
+				iterators::chunk_iter<TIterator>(end_, end_, size)
+				);
+		}
+		//sliding_window
+		Queryable<iterators::sliding_window_iter<TIterator>> sliding_window(size_t size, size_t step = 1) const
+		{
+			if (size == 0 || step == 0) LINQ_THROW("The window size and step should be positive.");
+			return Queryable<iterators::sliding_window_iter<TIterator>>(
+				iterators::sliding_window_iter<TIterator>(begin_, end_, size, step),
+				iterators::sliding_window_iter<TIterator>(end_, end_, size, step)
+				);
+		}
+		//chunk_by
+		template<typename TPredict>
+		Queryable<iterators::chunk_by_iter<TIterator, TPredict>> chunk_by(const TPredict& func) const
+		{
+			return Queryable<iterators::chunk_by_iter<TIterator, TPredict>>(
+				iterators::chunk_by_iter<TIterator, TPredict>(begin_, end_, func),
+				iterators::chunk_by_iter<TIterator, TPredict>(end_, end_, func)
+				);
+		}
+		//group_adjacent, lazy groups of consecutive elements with equal keys
+		template<typename TPredict>
+		Queryable<iterators::group_adjacent_iter<TIterator, TPredict>> group_adjacent(const TPredict& keySelector) const
+		{
+			return Queryable<iterators::group_adjacent_iter<TIterator, TPredict>>(
+				iterators::group_adjacent_iter<TIterator, TPredict>(begin_, end_, keySelector),
+				iterators::group_adjacent_iter<TIterator, TPredict>(end_, end_, keySelector)
+				);
+		}
+		//aggregate
+		template<typename TInit, typename TPredict>
+		constexpr TInit aggregate(const TInit &init, const TPredict& func) const
+		{
+			if(empty()) LINQ_THROW("Empty Collection");
+			auto result = init;
+			for(auto iter = begin_; iter != end_; ++iter)
+			{
+				result = func(result, *iter);
+			}
+			return result;
+		}
+        template<typename TPredict>
+        constexpr TElement aggregate(const TPredict& func) const
+        {
+            if(empty()) LINQ_THROW("Empty Collection");
+            auto iter = begin_;
+            auto result = *iter;
+            while(++iter != end_)
+            {
+                result = func(result, *iter);
+            }
+            return result;
+        }
+		//scan, yields every intermediate accumulator
+		template<typename TAccumulate, typename TPredict>
+		Queryable<iterators::scan_iter<TIterator, TAccumulate, TPredict>> scan(const TAccumulate& init, const TPredict& func) const
+		{
+			return Queryable<iterators::scan_iter<TIterator, TAccumulate, TPredict>>(
+				iterators::scan_iter<TIterator, TAccumulate, TPredict>(begin_, end_, init, func),
+				iterators::scan_iter<TIterator, TAccumulate, TPredict>(end_, end_, init, func)
+				);
+		}
+		//scan, func should be associative
+		template<typename TAccumulate, typename TPredict>
+		Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TAccumulate>>>> scan(const execution::parallel_policy& policy, const TAccumulate& init, const TPredict& func) const
+		{
+			size_t concurrency = parallel::concurrency(policy);
+			auto p = with_random_access([&](auto first, auto last)
+			{
+				return std::make_shared<std::vector<TAccumulate>>(parallel::inclusive_scan(first, last, init, func, concurrency));
+			});
+			return Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TAccumulate>>>>(
+				iterators::adapter_iter<std::shared_ptr<std::vector<TAccumulate>>>(p, p->begin(), p->end()),
+				iterators::adapter_iter<std::shared_ptr<std::vector<TAccumulate>>>(p, p->end(), p->end())
+				);
+		}
+		//average with function
+		template<typename TPredict>
+		average_type<clean_type<decltype(std::declval<const TPredict&>()(std::declval<const TElement&>()))>> average(const TPredict& func) const
+		{
+			if(empty()) LINQ_THROW("Empty Collection");
+			average_type<clean_type<decltype(func(*begin_))>> sum = 0;
+			size_t cnt = 0;
+			for(auto iter = begin_; iter != end_; ++iter)
+			{
+				++cnt;
+				sum += func(*iter);
+			}
+			return sum/cnt;
+		}
+		//average
+		average_type<TElement> average() const
+		{
+			return average([](const TElement& e){return e;});
+		}
+		//average with summation mode
+		template<typename TMode>
+		auto average(const TMode&) const -> average_type<decltype(TMode::template sum<TElement>(begin_, end_))>
+		{
+			if(empty()) LINQ_THROW("Empty Collection");
+			typedef average_type<decltype(TMode::template sum<TElement>(begin_, end_))> TAverage;
+			size_t count = 0;
+			auto total = TMode::template sum<TElement>(summation::counting_iterator<TIterator>(begin_, &count), summation::counting_iterator<TIterator>(end_, &count));
+			return static_cast<TAverage>(total) / static_cast<TAverage>(count);
+		}
+		//aggregate_many, evaluates every aggregator in one traversal
+		template<typename... TAggregators>
+		std::tuple<aggregators::result_t<TAggregators, TElement>...> aggregate_many(const TAggregators&... aggs) const
+		{
+			std::tuple<aggregators::accumulator_t<TAggregators, TElement>...> accumulators(aggs...);
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				aggregators::accumulate(accumulators, *iter, std::index_sequence_for<TAggregators...>());
+			}
+			return aggregators::results(accumulators, std::index_sequence_for<TAggregators...>());
+		}
+		template<typename... TAggregators>
+		std::tuple<aggregators::result_t<TAggregators, TElement>...> aggregate_many(const execution::parallel_policy& policy, const TAggregators&... aggs) const
+		{
+			typedef std::tuple<aggregators::accumulator_t<TAggregators, TElement>...> TAccumulators;
+			const size_t min_block_size = 1 << 13;
+			size_t concurrency = parallel::concurrency(policy);
+			return with_random_access([&](auto first, auto last)
+			{
+				size_t size = static_cast<size_t>(last - first);
+				size_t blocks = std::max<size_t>(1, std::min(concurrency, size / min_block_size));
+				std::vector<TAccumulators> accumulators(blocks, TAccumulators(aggs...));
+				parallel::for_each_block(size, blocks, [&](size_t block, size_t lo, size_t hi)
+				{
+					for (size_t i = lo; i < hi; ++i)
+					{
+						aggregators::accumulate(accumulators[block], first[i], std::index_sequence_for<TAggregators...>());
+					}
+				});
+				for (size_t block = 1; block < blocks; ++block)
+				{
+					aggregators::merge(accumulators[0], accumulators[block], std::index_sequence_for<TAggregators...>());
+				}
+				return aggregators::results(accumulators[0], std::index_sequence_for<TAggregators...>());
+			});
+		}
+		//stats, count, sum, min, max, mean and variance in one traversal
+		statistics<TElement> stats() const
+		{
+			return std::get<0>(aggregate_many(statistics_of()));
+		}
+		statistics<TElement> stats(const execution::parallel_policy& policy) const
+		{
+			return std::get<0>(aggregate_many(policy, statistics_of()));
+		}
+		//max
+		constexpr TElement max() const
+		{
+			return aggregate([](TElement a, TElement b){return a>b?a:b;});
+		}
+		//min
+		constexpr TElement min() const
+		{
+			return aggregate([](TElement a, TElement b){return a<b?a:b;});
+		}
+		//min_by
+		template<typename TPredict>
+		TElement min_by(const TPredict& keySelector) const
+		{
+			if (empty()) LINQ_THROW("Empty Collection");
+			auto iter = begin_;
+			TElement result = *iter;
+			auto key = keySelector(result);
+			while (++iter != end_)
+			{
+				auto current = keySelector(*iter);
+				if (current < key)
+				{
+					key = current;
+					result = *iter;
+				}
+			}
+			return result;
+		}
+		//max_by
+		template<typename TPredict>
+		TElement max_by(const TPredict& keySelector) const
+		{
+			if (empty()) LINQ_THROW("Empty Collection");
+			auto iter = begin_;
+			TElement result = *iter;
+			auto key = keySelector(result);
+			while (++iter != end_)
+			{
+				auto current = keySelector(*iter);
+				if (key < current)
+				{
+					key = current;
+					result = *iter;
+				}
+			}
+			return result;
+		}
+		//top_k, the count elements with the largest keys in descending order
+		template<typename TPredict>
+		Queryable<iterators::ordered_iter<TIterator, key_comparer<TPredict, true>>> top_k(size_t count, const TPredict& keySelector) const
+		{
+			return order_by_descending(keySelector).take(count);
+		}
+		//sum
+		constexpr TElement sum() const
+		{
+			return aggregate([](TElement a, TElement b){return b+a;});
+		}
+		//sum with summation mode
+		template<typename TMode>
+		auto sum(const TMode&) const -> decltype(TMode::template sum<TElement>(begin_, end_))
+		{
+			return TMode::template sum<TElement>(begin_, end_);
+		}
+		//any without parameter
+		constexpr bool any() const
+		{
+			return !empty();
+		}
+		//any
+		template<typename TPredict>
+		constexpr bool any(const TPredict& func) const
+		{
+			for(auto iter = begin_; iter != end_; ++iter)
+			{
+				if(func(*iter))
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+		//all
+		template<typename TPredict>
+		constexpr bool all(const TPredict& func) const
+		{
+			for(auto iter = begin_; iter != end_; ++iter)
+			{
+				if(!func(*iter))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+		//count
+		constexpr size_t count() const
+		{
+			return count_range(begin_, end_);
+		}
+		//long count
+		long long_count() const
+		{
+			return static_cast<long>(count_range(begin_, end_));
+		}
+		//sequence equal
+		template<typename TList>
+		bool sequence_equal(const TList &seq) const
+		{
+			auto end1 = this->end();
+			auto end2 = std::end(seq);
+            auto it1 = this->begin();
+            auto it2 = std::begin(seq);
+			for (;it1 != end1 && it2 != end2; ++it1, ++it2)
+			{
+				if(*it1 != *it2) return false;
+			}
+			return it1 == end1 && it2 == end2;
+		}
+
+        template<typename T>
+        bool sequence_equal(const std::initializer_list<T> &il) const
+        {
+            auto end1 = this->end();
+            auto end2 = std::end(il);
+            auto it1 = this->begin();
+            auto it2 = std::begin(il);
+            for (;it1 != end1 && it2 != end2; ++it1, ++it2)
+            {
+                if(*it1 != *it2) return false;
+            }
+            return it1 == end1 && it2 == end2;
+        }
+		//to vector
+		std::vector<TElement> to_vector() const
+		{
+			std::vector<TElement> vector;
+			for(auto iter = begin_; iter != end_; ++iter)
+			{
+				vector.emplace_back(*iter);
+			}
+			return vector;
+		}
+		//to list
+		std::list<TElement> to_list() const
+		{
+			std::list<TElement> list;
+			for (auto iter = begin_; iter != end_ ; ++iter)
+			{
+				list.emplace_back(*iter);
+			}
+			return list;
+		}
+		//to set
+		std::set<TElement> to_set() const
+		{
+			std::set<TElement> set;
+			for (auto iter = begin_; iter != end_ ; ++iter)
+			{
+				set.insert(*iter);
+			}
+			return set;
+		}
+		//to unordered_set
+		std::set<TElement> to_unordered_set() const
+		{
+			std::unordered_set<TElement> set;
+			for (auto iter = begin_; iter != end_ ; ++iter)
+			{
+				set.insert(*iter);
+			}
+			return set;
+		}
+		//to map
+		template<typename TPredict1, typename TPredict2>
+		auto to_map(const TPredict1& keySelector, const TPredict2& valueSelector) const -> std::map<decltype(keySelector(*begin_)), decltype(valueSelector(*begin_))>
+		{
+			std::map<decltype(keySelector(*begin_)), decltype(valueSelector(*begin_))> map;
+			for (auto iter = begin_; iter != end_ ; ++iter)
+			{
+				map.insert(std::make_pair(keySelector(*iter), valueSelector(*iter)));
+			}
+			return map;
+		}
+		//to_index, a hash index of the elements for repeated lookups, keys need std::hash and ==
+		template<typename TPredict>
+		auto to_index(const TPredict& keySelector) const -> hash_index<clean_type<decltype(keySelector(std::declval<TElement&>()))>, TElement>
+		{
+			return to_lookup(keySelector, aggregators::identity());
+		}
+		//to_lookup, a hash index of valueSelector(element) by key
+		template<typename TPredict1, typename TPredict2>
+		auto to_lookup(const TPredict1& keySelector, const TPredict2& valueSelector) const
+			-> hash_index<clean_type<decltype(keySelector(std::declval<TElement&>()))>, clean_type<decltype(valueSelector(std::declval<TElement&>()))>>
+		{
+			std::vector<clean_type<decltype(keySelector(std::declval<TElement&>()))>> keys;
+			std::vector<clean_type<decltype(valueSelector(std::declval<TElement&>()))>> values;
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				keys.push_back(keySelector(*iter));
+				values.push_back(valueSelector(*iter));
+			}
+			return hash_index<clean_type<decltype(keySelector(std::declval<TElement&>()))>, clean_type<decltype(valueSelector(std::declval<TElement&>()))>>(std::move(keys), std::move(values));
+		}
+		//to_sorted_index, the elements sorted by key for binary search and range queries
+		template<typename TPredict>
+		auto to_sorted_index(const TPredict& keySelector) const -> sorted_index<clean_type<decltype(keySelector(std::declval<TElement&>()))>, TElement>
+		{
+			std::vector<clean_type<decltype(keySelector(std::declval<TElement&>()))>> keys;
+			std::vector<TElement> elements;
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				keys.push_back(keySelector(*iter));
+				elements.push_back(*iter);
+			}
+			return sorted_index<clean_type<decltype(keySelector(std::declval<TElement&>()))>, TElement>(std::move(keys), std::move(elements));
+		}
+		//to_stream, elements are written as they are pulled through serializer<TElement>, returns the number of elements
+		size_t to_stream(std::ostream& out, const io::write_options& options = io::write_options()) const
+		{
+			return to_stream(out, io::default_serializer(), options);
+		}
+		//to_stream with a serializer called as serializer(writer, element), the writer takes writer.write(data, size)
+		template<typename TSerializer>
+		size_t to_stream(std::ostream& out, const TSerializer& serializer, const io::write_options& options = io::write_options()) const
+		{
+			io::block_writer<io::stream_sink> writer(options, out);
+			return write_to(writer, serializer);
+		}
+		//to_file, the file is replaced
+		size_t to_file(const std::string& path, const io::write_options& options = io::write_options()) const
+		{
+			return to_file(path, io::default_serializer(), options);
+		}
+		template<typename TSerializer>
+		size_t to_file(const std::string& path, const TSerializer& serializer, const io::write_options& options = io::write_options()) const
+		{
+			io::block_writer<io::file_sink> writer(options, path, options.direct);
+			return write_to(writer, serializer);
+		}
+		//concat
+		template<typename TIterator2>
+		constexpr Queryable<iterators::concat_iter<TIterator, TIterator2>> concat(const Queryable<TIterator2>& iter2) const
+		{
+			return Queryable<iterators::concat_iter<TIterator, TIterator2>>(
+				iterators::concat_iter<TIterator, TIterator2>(begin_, end_, iter2.begin(), iter2.end()),
+				iterators::concat_iter<TIterator, TIterator2>(end_, end_, iter2.end(), iter2.end())
+				);
+		}
+        template<typename TList>
+        constexpr auto concat(const TList& list) const -> Queryable<iterators::concat_iter<TIterator, decltype(std::begin(list))>>
+        {
+            using TIterator2 = decltype(std::begin(list));
+            return Queryable<iterators::concat_iter<TIterator, TIterator2>>(
+                iterators::concat_iter<TIterator, TIterator2>(begin_, end_, std::begin(list), std::end(list)),
+                iterators::concat_iter<TIterator, TIterator2>(end_, end_, std::end(list), std::end(list))
+                );
+        }
+		//contains
+		constexpr bool contains(const TElement& item) const
+		{
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				if (*iter == item) return true;
+			}
+			return false;
+		}
+		//first without parameter
+		constexpr TResult first() const
+		{
+			if (empty()) LINQ_THROW("empty collection");
+			return *begin_;
+		}
+
+		//first with parameter
+		template<typename TPredict>
+		constexpr TResult first(const TPredict& func) const
+		{
+			if (empty()) LINQ_THROW("empty collection");
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				if (func(*iter)) return *iter;
+			}
+			LINQ_THROW("Not found");
+		}
+
+		//last without parameter, random access and stable sources are not copied element by element
+		TResult last() const
+		{
+			if (empty()) LINQ_THROW("empty collection");
+			return last_element(std::integral_constant<bool, is_random_access<TIterator>::value || stable_reference<TIterator>::value>());
+		}
+
+		//last with parameter
+		template<typename TPredict>
+		TResult last(const TPredict& func) const
+		{
+			if (empty()) LINQ_THROW("empty collection");
+			return last_match(func, stable_reference<TIterator>());
+		}
+
+		//first_or_default without parameter
+		TElement first_or_default() const
+		{
+			if (empty()) return TElement{};
+			return *begin_;
+		}
+
+		//first_or_default with parameter
+		template<typename TPredict>
+		TElement first_or_default(const TPredict& func) const
+		{
+			if (empty()) return TElement{};
+			auto iter = begin_;
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				if (func(*iter)) return *iter;
+			}
+			return TElement{};
+		}
+
+		//last_or_default without parameter
+		TElement last_or_default() const
+		{
+			TElement ret{};
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				ret = *iter;
+			}
+			return ret;
+		}
+
+		//last_or_default with parameter
+		template<typename TPredict>
+		TElement last_or_default(const TPredict& func) const
+		{
+			TElement ret{};
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				if (func(*iter)) ret = *iter;
+			}
+			return ret;
+		}
+		//empty
+		constexpr bool empty() const
+		{
+			return begin_ == end_;
+		}
+		//default_if_empty without parameter
+		Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>> default_if_empty() const
+		{
+			return default_if_empty(TElement());
+		}
+
+		//default_if_empty with parameter
+		Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>> default_if_empty(const TElement& default_value) const
+		{
+			auto p = std::make_shared<std::vector<TElement>>();
+			if (empty())
+			{
+				p->push_back(default_value);
+			}
+			else
+			{
+				for (auto iter = begin_; iter != end_; ++iter)
+				{
+					p->push_back(*iter);
+				}
+			}
+			return Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>>(
+				iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>(p, p->begin(), p->end()),
+				iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>(p, p->end(), p->end())
+				);
+		}
+		//element_at
+		TResult element_at(size_t index) const
+		{
+			auto rest = skip(index);
+			if (rest.empty()) LINQ_THROW("Index out of range");
+			return *rest.begin();
+		}
+		//element_at_or_default
+		TElement element_at_or_default(size_t index) const
+		{
+			auto rest = skip(index);
+			if (rest.empty()) return TElement{};
+			return *rest.begin();
+		}
+#if __cplusplus >= 201703L
+		//try_first, the try_ operators return an empty optional where the others throw, also without exceptions
+		std::optional<TElement> try_first() const
+		{
+			if (empty()) return std::nullopt;
+			return *begin_;
+		}
+		template<typename TPredict>
+		std::optional<TElement> try_first(const TPredict& func) const
+		{
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				if (func(*iter)) return *iter;
+			}
+			return std::nullopt;
+		}
+		//try_last
+		std::optional<TElement> try_last() const
+		{
+			if (empty()) return std::nullopt;
+			if constexpr (is_random_access<TIterator>::value)
+			{
+				return *(end_ - 1);
+			}
+			else
+			{
+				std::optional<TElement> result;
+				for (auto iter = begin_; iter != end_; ++iter)
+				{
+					result = *iter;
+				}
+				return result;
+			}
+		}
+		template<typename TPredict>
+		std::optional<TElement> try_last(const TPredict& func) const
+		{
+			std::optional<TElement> result;
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				if (func(*iter)) result = *iter;
+			}
+			return result;
+		}
+		//try_single, empty for none and for more than one value
+		std::optional<TElement> try_single() const
+		{
+			if (empty()) return std::nullopt;
+			auto iter = begin_;
+			if (++iter != end_) return std::nullopt;
+			return *begin_;
+		}
+		template<typename TPredict>
+		std::optional<TElement> try_single(const TPredict& func) const
+		{
+			std::optional<TElement> result;
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				if (!func(*iter)) continue;
+				if (result) return std::nullopt;
+				result = *iter;
+			}
+			return result;
+		}
+		//try_element_at
+		std::optional<TElement> try_element_at(size_t index) const
+		{
+			auto rest = skip(index);
+			if (rest.empty()) return std::nullopt;
+			return *rest.begin();
+		}
+		//try_aggregate
+		template<typename TPredict>
+		std::optional<TElement> try_aggregate(const TPredict& func) const
+		{
+			if (empty()) return std::nullopt;
+			return aggregate(func);
+		}
+		//try_max
+		std::optional<TElement> try_max() const
+		{
+			if (empty()) return std::nullopt;
+			return max();
+		}
+		//try_min
+		std::optional<TElement> try_min() const
+		{
+			if (empty()) return std::nullopt;
+			return min();
+		}
+		//try_average
+		std::optional<average_type<TElement>> try_average() const
+		{
+			if (empty()) return std::nullopt;
+			return average();
+		}
+		template<typename TPredict>
+		auto try_average(const TPredict& func) const -> std::optional<decltype(average(func))>
+		{
+			if (empty()) return std::nullopt;
+			return average(func);
+		}
+#endif
+		//distinct
+		Queryable<iterators::adapter_iter<std::shared_ptr<std::set<TElement>>>> distinct() const
+		{
+			if (empty()) LINQ_THROW("Empty Collection");
+			auto set = std::make_shared<std::set<TElement>>();
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				set->insert(*iter);
+			}
+			return Queryable<iterators::adapter_iter<std::shared_ptr<std::set<TElement>>>>(
+				iterators::adapter_iter<std::shared_ptr<std::set<TElement>>>(set, set->begin(), set->end()),
+				iterators::adapter_iter<std::shared_ptr<std::set<TElement>>>(set, set->end(), set->end())
+				);
+		}
+		//distinct with a memory budget, values are hash partitioned into temp files once the set outgrows it, values need std::hash
+		Queryable<iterators::spilled_iter<TElement, std::less<TElement>>> distinct(const memory_budget& budget) const
+		{
+			if (empty()) LINQ_THROW("Empty Collection");
+			spill::run_set<TElement> runs;
+			spill::distinct<TElement>(visitor(), 0, budget, runs);
+			return merge_runs(std::move(runs), std::less<TElement>());
+		}
+		//except
+		template<typename TList>
+		Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>> except(const TList& l) const
+		{
+            auto q = from(l);
+			if(empty() || q.empty()) LINQ_THROW("Empty Collection");
+			auto v = std::make_shared<std::vector<TElement>>();
+			std::set<TElement> set_ex(q.begin(), q.end());
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				//if element is not in exclude set
+				if (set_ex.insert(*iter).second)
+				{
+					v->push_back(*iter);
+				}
+			}
+			return Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>>(
+				iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>(v, v->begin(), v->end()),
+				iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>(v, v->end(), v->end())
+				);
+		}
+		//intersect
+		template<typename TList>
+		Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>> intersect(const TList& l) const
+		{
+            auto q = from(l);
+			if (empty() || q.empty()) LINQ_THROW("Empty Collection");
+			auto v = std::make_shared<std::vector<TElement>>(std::distance(q.begin(), q.end()));
+            std::set<TElement> set1(begin_, end_);
+			std::set<TElement> set2(q.begin(), q.end());
+            auto it = std::set_intersection(set1.begin(), set1.end(), set2.begin(), set2.end(), v->begin());
+            v->resize(it-v->begin());
+			return Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>>(
+				iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>(v, v->begin(), v->end()),
+				iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>(v, v->end(), v->end())
+				);
+		}
+		//except with a memory budget
+		template<typename TList>
+		Queryable<iterators::select_iter<iterators::spilled_iter<std::pair<size_t, TElement>, spill::first_less>, spill::select_second>> except(const TList& l, const memory_budget& budget) const
+		{
+			auto q = from(l);
+			if (empty() || q.empty()) LINQ_THROW("Empty Collection");
+			auto source = visitor();
+			auto indexed = [&source](const auto& func)
+			{
+				size_t index = 0;
+				source([&](const TElement& value){ func(std::pair<size_t, TElement>(index++, value)); });
+			};
+			spill::run_set<std::pair<size_t, TElement>> runs;
+			spill::except<TElement>(indexed, q.visitor(), 0, budget, runs);
+			return merge_runs(std::move(runs), spill::first_less()).select(spill::select_second());
+		}
+		//intersect with a memory budget, only this side is kept in memory
+		template<typename TList>
+		Queryable<iterators::spilled_iter<TElement, std::less<TElement>>> intersect(const TList& l, const memory_budget& budget) const
+		{
+			auto q = from(l);
+			if (empty() || q.empty()) LINQ_THROW("Empty Collection");
+			spill::run_set<TElement> runs;
+			spill::intersect<TElement>(visitor(), q.visitor(), 0, budget, runs);
+			return merge_runs(std::move(runs), std::less<TElement>());
+		}
+		//except with a bloom filter over l, most elements missing from l skip the lookup in its set, values need std::hash and ==
+		template<typename TList>
+		Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>> except(const TList& l, const bloom_filter_options& options) const
+		{
+			auto q = from(l);
+			if (empty() || q.empty()) LINQ_THROW("Empty Collection");
+			std::set<TElement> set_ex(q.begin(), q.end());
+			bloom_filter filter(set_ex.size(), options.bits_per_key);
+			for (auto& value : set_ex)
+			{
+				filter.insert(std::hash<TElement>()(value));
+			}
+			bloom_filter_statistics statistics{};
+			auto v = std::make_shared<std::vector<TElement>>();
+			//the kept elements are deduplicated by hash, a rejected element never touches an ordered set
+			std::unordered_set<TElement> emitted;
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				++statistics.probes;
+				if (!filter.may_contain(std::hash<TElement>()(*iter)))
+				{
+					++statistics.rejected;
+				}
+				else if (set_ex.count(*iter) != 0)
+				{
+					++statistics.matches;
+					continue;
+				}
+				if (emitted.insert(*iter).second)
+				{
+					v->push_back(*iter);
+				}
+			}
+			if (options.statistics) *options.statistics = statistics;
+			return Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>>(
+				iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>(v, v->begin(), v->end()),
+				iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>(v, v->end(), v->end())
+				);
+		}
+		//intersect with a bloom filter over l, values need std::hash
+		template<typename TList>
+		Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>> intersect(const TList& l, const bloom_filter_options& options) const
+		{
+			auto q = from(l);
+			if (empty() || q.empty()) LINQ_THROW("Empty Collection");
+			std::set<TElement> set2(q.begin(), q.end());
+			bloom_filter filter(set2.size(), options.bits_per_key);
+			for (auto& value : set2)
+			{
+				filter.insert(std::hash<TElement>()(value));
+			}
+			bloom_filter_statistics statistics{};
+			std::set<TElement> set1;
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				++statistics.probes;
+				if (!filter.may_contain(std::hash<TElement>()(*iter)))
+				{
+					++statistics.rejected;
+				}
+				else if (set2.count(*iter) != 0)
+				{
+					++statistics.matches;
+					set1.insert(*iter);
+				}
+			}
+			if (options.statistics) *options.statistics = statistics;
+			auto v = std::make_shared<std::vector<TElement>>(set1.begin(), set1.end());
+			return Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>>(
+				iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>(v, v->begin(), v->end()),
+				iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>(v, v->end(), v->end())
+				);
+		}
+		//union, use linq_union to avoid key word union
+		template<typename TList>
+		Queryable<iterators::adapter_iter<std::shared_ptr<std::set<TElement>>>> linq_union(const TList& l) const
+		{
+            auto q = from(l);
+			if (empty() || q.empty()) LINQ_THROW("Empty Collection");
+			return concat(q).distinct();
+		}
+		//zip
+        template<typename TList>
+		constexpr auto zip(const TList& l) const ->Queryable<iterators::zip_iter<TIterator, decltype(std::begin(l))>> const
+		{
+            using TIterator2 = decltype(std::begin(l));
+			return Queryable<iterators::zip_iter<TIterator, TIterator2>>(
+				iterators::zip_iter<TIterator, TIterator2>(begin_, end_, std::begin(l), std::end(l)),
+				iterators::zip_iter<TIterator, TIterator2>(end_, end_, std::end(l), std::end(l)));
+		}
+		//zip_ref, pairs of std::reference_wrapper to the elements of both sources instead of copies
+		template<typename TList>
+		auto zip_ref(const TList& l) const -> Queryable<iterators::zip_ref_iter<TIterator, decltype(std::begin(l))>>
+		{
+			using TIterator2 = decltype(std::begin(l));
+			static_assert(stable_reference<TIterator>::value && stable_reference<TIterator2>::value, "zip_ref needs sources whose elements outlive their iterators.");
+			return Queryable<iterators::zip_ref_iter<TIterator, TIterator2>>(
+				iterators::zip_ref_iter<TIterator, TIterator2>(begin_, end_, std::begin(l), std::end(l)),
+				iterators::zip_ref_iter<TIterator, TIterator2>(end_, end_, std::end(l), std::end(l)));
+		}
+		//assume_sorted, the source is already sorted by comparer, set operators merge and searches bisect
+		template<typename TComparer>
+		SortedQueryable<TIterator, TComparer> assume_sorted(const TComparer& comparer) const
+		{
+			return SortedQueryable<TIterator, TComparer>(begin_, end_, comparer);
+		}
+		//as_sorted, the source is already in ascending order
+		SortedQueryable<TIterator, std::less<TElement>> as_sorted() const
+		{
+			return assume_sorted(std::less<TElement>());
+		}
+		//order_by
+		template<typename TPredict>
+		OrderedQueryable<TIterator, key_comparer<TPredict, false>> order_by(const TPredict& keySelector) const
+		{
+			return OrderedQueryable<TIterator, key_comparer<TPredict, false>>(begin_, end_, key_comparer<TPredict, false>(keySelector), 1);
+		}
+		template<typename TPredict>
+		OrderedQueryable<TIterator, key_comparer<TPredict, false>> order_by(const execution::parallel_policy& policy, const TPredict& keySelector) const
+		{
+			return OrderedQueryable<TIterator, key_comparer<TPredict, false>>(begin_, end_, key_comparer<TPredict, false>(keySelector), parallel::concurrency(policy));
+		}
+		//order_by_descending
+		template<typename TPredict>
+		OrderedQueryable<TIterator, key_comparer<TPredict, true>> order_by_descending(const TPredict& keySelector) const
+		{
+			return OrderedQueryable<TIterator, key_comparer<TPredict, true>>(begin_, end_, key_comparer<TPredict, true>(keySelector), 1);
+		}
+		template<typename TPredict>
+		OrderedQueryable<TIterator, key_comparer<TPredict, true>> order_by_descending(const execution::parallel_policy& policy, const TPredict& keySelector) const
+		{
+			return OrderedQueryable<TIterator, key_comparer<TPredict, true>>(begin_, end_, key_comparer<TPredict, true>(keySelector), parallel::concurrency(policy));
+		}
+		//order_by with a memory budget, sorted runs over the budget are spilled to temp files and merged lazily
+		template<typename TPredict>
+		Queryable<iterators::external_merge_iter<TIterator, key_comparer<TPredict, false>>> order_by(const TPredict& keySelector, const memory_budget& budget) const
+		{
+			return external_sort(key_comparer<TPredict, false>(keySelector), budget);
+		}
+		//order_by_descending with a memory budget
+		template<typename TPredict>
+		Queryable<iterators::external_merge_iter<TIterator, key_comparer<TPredict, true>>> order_by_descending(const TPredict& keySelector, const memory_budget& budget) const
+		{
+			return external_sort(key_comparer<TPredict, true>(keySelector), budget);
+		}
+		//group_by
+		template<typename TPredict>
+		auto group_by(const TPredict& keySelector) const -> std::vector<std::vector<TElement>> const
+		{
+			return group_by(keySelector, [](const TElement &ele) {return ele; });
+		}
+		//group_by with value selector
+		template<typename TPredict1, typename TPredict2>
+		auto group_by(const TPredict1& keySelector, const TPredict2& valueSelector) const -> std::vector<std::vector<decltype(valueSelector(std::declval<TElement&>()))>> const
+		{
+			using TKey = decltype(keySelector(std::declval<TElement&>()));
+			using TValue = decltype(valueSelector(std::declval<TElement&>()));
+            std::vector<std::vector<TValue>> vv;
+            std::map<TKey, std::vector<TValue>> m;
+
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+                auto key = keySelector(*iter);
+                auto value = valueSelector(*iter);
+                if(m.find(key) != m.end())
+                {
+                    auto &v = m[key];
+                    v.push_back(value);
+                }
+                else
+                {
+                    std::vector<TValue> v;
+                    v.push_back(value);
+                    m.insert(std::make_pair(key, v));
+                }
+			}
+            for(auto& p : m)
+            {
+                vv.push_back(p.second);
+            }
+            return vv;
+		}
+		//group_by with a memory budget, (key, value) pairs are hash partitioned into temp files once the groups outgrow it
+		//the groups are enumerated lazily in the order of the serial group_by, keys need std::hash
+		template<typename TPredict1, typename TPredict2>
+		auto group_by(const TPredict1& keySelector, const TPredict2& valueSelector, const memory_budget& budget) const
+			-> Queryable<iterators::select_iter<iterators::spilled_iter<std::pair<clean_type<decltype(keySelector(std::declval<TElement&>()))>, std::vector<clean_type<decltype(valueSelector(std::declval<TElement&>()))>>>, spill::first_less>, spill::select_second>>
+		{
+			using TKey = clean_type<decltype(keySelector(std::declval<TElement&>()))>;
+			using TValue = clean_type<decltype(valueSelector(std::declval<TElement&>()))>;
+			auto source = visitor();
+			auto records = [&](const auto& func)
+			{
+				source([&](const TElement& value){ func(std::pair<TKey, TValue>(keySelector(value), valueSelector(value))); });
+			};
+			spill::run_set<std::pair<TKey, std::vector<TValue>>> runs;
+			spill::group_by<TKey, TValue>(records, 0, budget, runs);
+			return merge_runs(std::move(runs), spill::first_less()).select(spill::select_second());
+		}
+		template<typename TPredict>
+		auto group_by(const TPredict& keySelector, const memory_budget& budget) const
+			-> decltype(group_by(keySelector, aggregators::identity(), budget))
+		{
+			return group_by(keySelector, aggregators::identity(), budget);
+		}
+		//group_by in parallel, keys are hash partitioned so each worker owns a disjoint key range
+		//groups are ordered by key and keep the source order like the serial group_by, keys need std::hash
+		template<typename TPredict>
+		std::vector<std::vector<TElement>> group_by(const execution::parallel_policy& policy, const TPredict& keySelector) const
+		{
+			return group_by(policy, keySelector, [](const TElement &ele) {return ele; });
+		}
+		template<typename TPredict1, typename TPredict2>
+		auto group_by(const execution::parallel_policy& policy, const TPredict1& keySelector, const TPredict2& valueSelector) const
+			-> std::vector<std::vector<clean_type<decltype(valueSelector(std::declval<TElement&>()))>>>
+		{
+			using TKey = clean_type<decltype(keySelector(std::declval<TElement&>()))>;
+			using TValue = clean_type<decltype(valueSelector(std::declval<TElement&>()))>;
+			typedef std::pair<TKey, std::vector<TValue>> TGroup;
+			size_t concurrency = parallel::concurrency(policy);
+			return with_random_access([&](auto first, auto last)
+			{
+				size_t size = static_cast<size_t>(last - first);
+				size_t blocks = parallel::blocks_for(size, concurrency);
+				auto lists = parallel::partition_by_key<TKey>(size, blocks, blocks, [&](size_t i){return keySelector(first[i]); });
+				//every partition is grouped by one worker, blocks are visited in order
+				std::vector<std::vector<TGroup>> partitions(blocks);
+				parallel::for_each_block(blocks, blocks, [&](size_t, size_t lo, size_t hi)
+				{
+					for (size_t partition = lo; partition < hi; ++partition)
+					{
+						auto& groups = partitions[partition];
+						std::unordered_map<TKey, size_t> index;
+						for (size_t block = 0; block < blocks; ++block)
+						{
+							for (auto& entry : lists[block][partition])
+							{
+								auto it = index.find(entry.first);
+								if (it == index.end())
+								{
+									it = index.emplace(entry.first, groups.size()).first;
+									groups.emplace_back(std::move(entry.first), std::vector<TValue>());
+								}
+								groups[it->second].second.push_back(valueSelector(first[entry.second]));
+							}
+						}
+					}
+				});
+				std::vector<TGroup> groups;
+				for (auto& partition : partitions)
+				{
+					std::move(partition.begin(), partition.end(), std::back_inserter(groups));
+				}
+				parallel::stable_sort(groups, [](const TGroup& a, const TGroup& b){return a.first < b.first; }, concurrency);
+				std::vector<std::vector<TValue>> vv;
+				vv.reserve(groups.size());
+				for (auto& group : groups)
+				{
+					vv.push_back(std::move(group.second));
+				}
+				return vv;
+			});
+		}
+		//group_aggregate, one aggregator result per key without building the groups, ordered by key
+		template<typename TPredict, typename TAggregator>
+		auto group_aggregate(const TPredict& keySelector, const TAggregator& agg) const
+			-> std::vector<std::pair<clean_type<decltype(keySelector(std::declval<TElement&>()))>, aggregators::result_t<TAggregator, TElement>>>
+		{
+			using TKey = clean_type<decltype(keySelector(std::declval<TElement&>()))>;
+			std::map<TKey, aggregators::accumulator_t<TAggregator, TElement>> table;
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				auto key = keySelector(*iter);
+				auto it = table.find(key);
+				if (it == table.end())
+				{
+					it = table.emplace(key, aggregators::accumulator_t<TAggregator, TElement>(agg)).first;
+				}
+				it->second.accumulate(*iter);
+			}
+			std::vector<std::pair<TKey, aggregators::result_t<TAggregator, TElement>>> result;
+			result.reserve(table.size());
+			for (auto& entry : table)
+			{
+				result.emplace_back(entry.first, entry.second.result());
+			}
+			return result;
+		}
+		//group_aggregate in parallel, thread local tables are merged per hash partition, keys need std::hash
+		template<typename TPredict, typename TAggregator>
+		auto group_aggregate(const execution::parallel_policy& policy, const TPredict& keySelector, const TAggregator& agg) const
+			-> std::vector<std::pair<clean_type<decltype(keySelector(std::declval<TElement&>()))>, aggregators::result_t<TAggregator, TElement>>>
+		{
+			using TKey = clean_type<decltype(keySelector(std::declval<TElement&>()))>;
+			typedef aggregators::accumulator_t<TAggregator, TElement> TAccumulator;
+			typedef std::pair<TKey, aggregators::result_t<TAggregator, TElement>> TResult;
+			typedef std::unordered_map<TKey, TAccumulator> TTable;
+			size_t concurrency = parallel::concurrency(policy);
+			return with_random_access([&](auto first, auto last)
+			{
+				size_t size = static_cast<size_t>(last - first);
+				size_t blocks = parallel::blocks_for(size, concurrency);
+				//every block keeps one table per partition
+				std::vector<std::vector<TTable>> tables(blocks, std::vector<TTable>(blocks));
+				parallel::for_each_block(size, blocks, [&](size_t block, size_t lo, size_t hi)
+				{
+					std::hash<TKey> hash;
+					for (size_t i = lo; i < hi; ++i)
+					{
+						TKey key = keySelector(first[i]);
+						auto& table = tables[block][parallel::partition_of(hash(key), blocks)];
+						auto it = table.find(key);
+						if (it == table.end())
+						{
+							it = table.emplace(std::move(key), TAccumulator(agg)).first;
+						}
+						it->second.accumulate(first[i]);
+					}
+				});
+				std::vector<std::vector<TResult>> partitions(blocks);
+				parallel::for_each_block(blocks, blocks, [&](size_t, size_t lo, size_t hi)
+				{
+					for (size_t partition = lo; partition < hi; ++partition)
+					{
+						TTable& merged = tables[0][partition];
+						for (size_t block = 1; block < blocks; ++block)
+						{
+							for (auto& entry : tables[block][partition])
+							{
+								auto it = merged.find(entry.first);
+								if (it == merged.end()) merged.emplace(entry.first, entry.second);
+								else it->second.merge(entry.second);
+							}
+						}
+						for (auto& entry : merged)
+						{
+							partitions[partition].emplace_back(entry.first, entry.second.result());
+						}
+					}
+				});
+				std::vector<TResult> result;
+				for (auto& partition : partitions)
+				{
+					std::move(partition.begin(), partition.end(), std::back_inserter(result));
+				}
+				parallel::stable_sort(result, [](const TResult& a, const TResult& b){return a.first < b.first; }, concurrency);
+				return result;
+			});
+		}
+		//join, pairs of outer and inner elements with equal keys, ordered by key, then outer and inner order
+		template<typename TInner, typename TPredict1, typename TPredict2>
+		auto join(const TInner& inner, const TPredict1& outerKeySelector, const TPredict2& innerKeySelector) const
+			-> Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<join_pair<clean_type<decltype(outerKeySelector(std::declval<TElement&>()))>, TElement, clean_type<decltype(*std::begin(inner))>>>>>>
+		{
+			using TKey = clean_type<decltype(outerKeySelector(std::declval<TElement&>()))>;
+			using TInnerElement = clean_type<decltype(*std::begin(inner))>;
+			std::map<TKey, std::pair<std::vector<TElement>, std::vector<TInnerElement>>> table;
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				table[outerKeySelector(*iter)].first.push_back(*iter);
+			}
+			for (auto iter = std::begin(inner); iter != std::end(inner); ++iter)
+			{
+				auto it = table.find(innerKeySelector(*iter));
+				if (it != table.end()) it->second.second.push_back(*iter);
+			}
+			std::vector<join_pair<TKey, TElement, TInnerElement>> result;
+			for (auto& entry : table)
+			{
+				for (auto& outer : entry.second.first)
+				{
+					for (auto& value : entry.second.second)
+					{
+						result.emplace_back(entry.first, std::make_pair(outer, value));
+					}
+				}
+			}
+			return from_values(std::move(result));
+		}
+		//join with a bloom filter over the outer keys, most inner elements without a partner skip the table, keys need std::hash
+		template<typename TInner, typename TPredict1, typename TPredict2>
+		auto join(const TInner& inner, const TPredict1& outerKeySelector, const TPredict2& innerKeySelector, const bloom_filter_options& options) const
+			-> Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<join_pair<clean_type<decltype(outerKeySelector(std::declval<TElement&>()))>, TElement, clean_type<decltype(*std::begin(inner))>>>>>>
+		{
+			using TKey = clean_type<decltype(outerKeySelector(std::declval<TElement&>()))>;
+			using TInnerElement = clean_type<decltype(*std::begin(inner))>;
+			std::map<TKey, std::pair<std::vector<TElement>, std::vector<TInnerElement>>> table;
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				table[outerKeySelector(*iter)].first.push_back(*iter);
+			}
+			bloom_filter filter(table.size(), options.bits_per_key);
+			for (auto& entry : table)
+			{
+				filter.insert(std::hash<TKey>()(entry.first));
+			}
+			bloom_filter_statistics statistics{};
+			for (auto iter = std::begin(inner); iter != std::end(inner); ++iter)
+			{
+				++statistics.probes;
+				TKey key = innerKeySelector(*iter);
+				if (!filter.may_contain(std::hash<TKey>()(key)))
+				{
+					++statistics.rejected;
+					continue;
+				}
+				auto it = table.find(key);
+				if (it == table.end()) continue;
+				++statistics.matches;
+				it->second.second.push_back(*iter);
+			}
+			if (options.statistics) *options.statistics = statistics;
+			std::vector<join_pair<TKey, TElement, TInnerElement>> result;
+			for (auto& entry : table)
+			{
+				for (auto& outer : entry.second.first)
+				{
+					for (auto& value : entry.second.second)
+					{
+						result.emplace_back(entry.first, std::make_pair(outer, value));
+					}
+				}
+			}
+			return from_values(std::move(result));
+		}
+		//join in parallel, both sides are hash partitioned and every partition pair is built and probed by one worker
+		//the output is in partition order unless the policy is ordered(), keys need std::hash
+		template<typename TInner, typename TPredict1, typename TPredict2>
+		auto join(const execution::parallel_policy& policy, const TInner& inner, const TPredict1& outerKeySelector, const TPredict2& innerKeySelector) const
+			-> Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<join_pair<clean_type<decltype(outerKeySelector(std::declval<TElement&>()))>, TElement, clean_type<decltype(*std::begin(inner))>>>>>>
+		{
+			using TKey = clean_type<decltype(outerKeySelector(std::declval<TElement&>()))>;
+			using TInnerElement = clean_type<decltype(*std::begin(inner))>;
+			typedef join_pair<TKey, TElement, TInnerElement> TJoin;
+			size_t concurrency = parallel::concurrency(policy);
+			auto inners = from(inner);
+			auto result = with_random_access([&](auto first, auto last)
+			{
+				return inners.with_random_access([&](auto inner_first, auto inner_last)
+				{
+					size_t size = static_cast<size_t>(last - first);
+					size_t inner_size = static_cast<size_t>(inner_last - inner_first);
+					size_t blocks = parallel::blocks_for(std::max(size, inner_size), concurrency);
+					size_t partitions = parallel::partitions_for(inner_size, blocks);
+					auto outer_lists = parallel::partition_by_key<TKey>(size, blocks, partitions, [&](size_t i){return outerKeySelector(first[i]); });
+					auto inner_lists = parallel::partition_by_key<TKey>(inner_size, blocks, partitions, [&](size_t i){return innerKeySelector(inner_first[i]); });
+					std::vector<std::vector<TJoin>> outputs(partitions);
+					parallel::for_each_block(partitions, blocks, [&](size_t, size_t lo, size_t hi)
+					{
+						for (size_t partition = lo; partition < hi; ++partition)
+						{
+							std::unordered_map<TKey, std::vector<size_t>> table;
+							for (auto& list : inner_lists)
+							{
+								for (auto& entry : list[partition])
+								{
+									table[entry.first].push_back(entry.second);
+								}
+							}
+							for (auto& list : outer_lists)
+							{
+								for (auto& entry : list[partition])
+								{
+									auto it = table.find(entry.first);
+									if (it == table.end()) continue;
+									for (size_t index : it->second)
+									{
+										outputs[partition].emplace_back(entry.first, std::make_pair(first[entry.second], inner_first[index]));
+									}
+								}
+							}
+						}
+					});
+					return parallel::concat(outputs, policy, concurrency);
+				});
+			});
+			return from_values(std::move(result));
+		}
+		//group_join, every outer element with the inner elements of the same key, ordered by key
+		template<typename TInner, typename TPredict1, typename TPredict2>
+		auto group_join(const TInner& inner, const TPredict1& outerKeySelector, const TPredict2& innerKeySelector) const
+			-> Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<join_pair<clean_type<decltype(outerKeySelector(std::declval<TElement&>()))>, TElement, linq<clean_type<decltype(*std::begin(inner))>>>>>>>
+		{
+			using TKey = clean_type<decltype(outerKeySelector(std::declval<TElement&>()))>;
+			using TInnerElement = clean_type<decltype(*std::begin(inner))>;
+			std::map<TKey, std::pair<std::vector<TElement>, std::vector<TInnerElement>>> table;
+			for (auto iter = begin_; iter != end_; ++iter)
+			{
+				table[outerKeySelector(*iter)].first.push_back(*iter);
+			}
+			for (auto iter = std::begin(inner); iter != std::end(inner); ++iter)
+			{
+				auto it = table.find(innerKeySelector(*iter));
+				if (it != table.end()) it->second.second.push_back(*iter);
+			}
+			std::vector<join_pair<TKey, TElement, linq<TInnerElement>>> result;
+			for (auto& entry : table)
+			{
+				linq<TInnerElement> group = from_values(std::move(entry.second.second));
+				for (auto& outer : entry.second.first)
+				{
+					result.emplace_back(entry.first, std::make_pair(outer, group));
+				}
+			}
+			return from_values(std::move(result));
+		}
+		//group_join in parallel, partitioned like the parallel join
+		template<typename TInner, typename TPredict1, typename TPredict2>
+		auto group_join(const execution::parallel_policy& policy, const TInner& inner, const TPredict1& outerKeySelector, const TPredict2& innerKeySelector) const
+			-> Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<join_pair<clean_type<decltype(outerKeySelector(std::declval<TElement&>()))>, TElement, linq<clean_type<decltype(*std::begin(inner))>>>>>>>
+		{
+			using TKey = clean_type<decltype(outerKeySelector(std::declval<TElement&>()))>;
+			using TInnerElement = clean_type<decltype(*std::begin(inner))>;
+			typedef join_pair<TKey, TElement, linq<TInnerElement>> TJoin;
+			size_t concurrency = parallel::concurrency(policy);
+			auto inners = from(inner);
+			auto result = with_random_access([&](auto first, auto last)
+			{
+				return inners.with_random_access([&](auto inner_first, auto inner_last)
+				{
+					size_t size = static_cast<size_t>(last - first);
+					size_t inner_size = static_cast<size_t>(inner_last - inner_first);
+					size_t blocks = parallel::blocks_for(std::max(size, inner_size), concurrency);
+					size_t partitions = parallel::partitions_for(inner_size, blocks);
+					auto outer_lists = parallel::partition_by_key<TKey>(size, blocks, partitions, [&](size_t i){return outerKeySelector(first[i]); });
+					auto inner_lists = parallel::partition_by_key<TKey>(inner_size, blocks, partitions, [&](size_t i){return innerKeySelector(inner_first[i]); });
+					std::vector<std::vector<TJoin>> outputs(partitions);
+					parallel::for_each_block(partitions, blocks, [&](size_t, size_t lo, size_t hi)
+					{
+						for (size_t partition = lo; partition < hi; ++partition)
+						{
+							std::unordered_map<TKey, std::vector<TInnerElement>> table;
+							for (auto& list : inner_lists)
+							{
+								for (auto& entry : list[partition])
+								{
+									table[entry.first].push_back(inner_first[entry.second]);
+								}
+							}
+							std::unordered_map<TKey, linq<TInnerElement>> groups;
+							for (auto& list : outer_lists)
+							{
+								for (auto& entry : list[partition])
+								{
+									auto it = groups.find(entry.first);
+									if (it == groups.end())
+									{
+										auto values = table.find(entry.first);
+										linq<TInnerElement> group = values == table.end() ? linq<TInnerElement>(from_empty<TInnerElement>()) : linq<TInnerElement>(from_values(std::move(values->second)));
+										it = groups.emplace(entry.first, group).first;
+									}
+									outputs[partition].emplace_back(entry.first, std::make_pair(first[entry.second], it->second));
+								}
+							}
+						}
+					});
+					return parallel::concat(outputs, policy, concurrency);
+				});
+			});
+			return from_values(std::move(result));
+		}
+	};
+
+	template<typename TIterator, typename TComparer>
+	class OrderedQueryable : public Queryable<iterators::ordered_iter<TIterator, TComparer>>
+	{
+		using TBase = Queryable<iterators::ordered_iter<TIterator, TComparer>>;
+		using TState = typename iterators::ordered_iter<TIterator, TComparer>::state;
+	private:
+		std::shared_ptr<TState> state_;
+
+		OrderedQueryable(const std::shared_ptr<TState>& state)
+			:TBase(iterators::ordered_iter<TIterator, TComparer>(state, false), iterators::ordered_iter<TIterator, TComparer>(state, true)), state_(state)
+		{
+
+		}
+
+		template<typename TComparer2>
+		OrderedQueryable<TIterator, then_comparer<TComparer, TComparer2>> then(const TComparer2& comparer) const
+		{
+			return OrderedQueryable<TIterator, then_comparer<TComparer, TComparer2>>(
+				state_->begin, state_->end, then_comparer<TComparer, TComparer2>(state_->comparer, comparer), state_->concurrency);
+		}
 	public:
-		constexpr Queryable() = default;
-		constexpr Queryable(const TIterator& begin, const TIterator& end)
-			:begin_(begin), end_(end){}
+		OrderedQueryable(const TIterator& begin, const TIterator& end, const TComparer& comparer, size_t concurrency, size_t limit = static_cast<size_t>(-1))
+			:OrderedQueryable(std::make_shared<TState>(begin, end, comparer, concurrency, limit))
+		{
+
+		}
 
-		TIterator begin() const
+		//take, selects the first count elements without sorting the whole source
+		TBase take(size_t count) const
 		{
-			return begin_;
+			return OrderedQueryable(state_->begin, state_->end, state_->comparer, state_->concurrency, std::min(count, state_->limit));
 		}
 
-		TIterator end() const
+		using TBase::first;
+
+		//first, a linear scan for the smallest element that keeps its position instead of a copy
+		typename std::conditional<stable_reference<TIterator>::value, const clean_type<value_type<TIterator>>&, clean_type<value_type<TIterator>>>::type first() const
 		{
-			return end_;
+			if (state_->begin == state_->end) LINQ_THROW("empty collection");
+			auto iter = state_->begin;
+			auto result = iter;
+			while (++iter != state_->end)
+			{
+				if (state_->comparer(*iter, *result)) result = iter;
+			}
+			return *result;
 		}
 
-		//where
+		//then_by
 		template<typename TPredict>
-		Queryable<iterators::where_iter<TIterator, TPredict>> where(const TPredict& func) const
+		OrderedQueryable<TIterator, then_comparer<TComparer, key_comparer<TPredict, false>>> then_by(const TPredict& keySelector) const
 		{
-			return Queryable<iterators::where_iter<TIterator, TPredict>>(
-				iterators::where_iter<TIterator, TPredict>(begin_, end_, func),
-				iterators::where_iter<TIterator, TPredict>(end_, end_, func)
-				);
+			return then(key_comparer<TPredict, false>(keySelector));
 		}
-		//select
+		//then_by_descending
 		template<typename TPredict>
-		Queryable<iterators::select_iter<TIterator, TPredict>> select(const TPredict& func) const
+		OrderedQueryable<TIterator, then_comparer<TComparer, key_comparer<TPredict, true>>> then_by_descending(const TPredict& keySelector) const
 		{
-			return Queryable<iterators::select_iter<TIterator, TPredict>>(
-				iterators::select_iter<TIterator, TPredict>(begin_, end_, func),
-				iterators::select_iter<TIterator, TPredict>(end_, end_, func)
-				);
+			return then(key_comparer<TPredict, true>(keySelector));
 		}
-        //select_many
-        template<typename TPredict>
-        auto select_many(const TPredict& func) const ->linq<clean_type<decltype(*func(*(TElement*)0).begin())>>
-        {
-            typedef decltype(func(*(TElement*)0)) TCollection;
-            typedef clean_type<decltype(*func(*(TElement*)0).begin())> TValue;
-            return select(func).aggregate(from_empty<TValue>(), [](const linq<TValue> &e1, const TCollection &e2){return e1.concat(e2);});
-        }
-		//single without parameter
-		TElement single() const
+	};
+
+	//assume_sorted, set operators become linear merges and searches bisect random access sources
+	//the order is trusted, a source that is not sorted by the comparer gives unspecified results
+	template<typename TIterator, typename TComparer>
+	class SortedQueryable : public Queryable<TIterator>, private func_holder<TComparer>
+	{
+		using TBase = Queryable<TIterator>;
+		using TElement = clean_type<value_type<TIterator>>;
+		template<typename TList>
+		using TOther = decltype(from(std::declval<const TList&>()).begin());
+		template<typename TList, iterators::merge_operation Operation>
+		using TMerged = SortedQueryable<iterators::set_merge_iter<TIterator, TOther<TList>, TComparer, Operation>, TComparer>;
+	private:
+		TIterator lower_bound(const TIterator& first, const TElement& item, std::true_type) const
 		{
-			auto it = begin_;
-			if (++it != end_) throw linq_exception("The collection should have only one value.");
-			return *begin_;
+			return std::lower_bound(first, this->end(), item, this->func());
 		}
-		//single with parameter
-		template<typename TPredict>
-		TElement single(const TPredict& func) const
+		TIterator lower_bound(TIterator first, const TElement& item, std::false_type) const
 		{
-			if (empty()) throw linq_exception("Empty collection.");
-			int cnt = 0;
-			for (auto it = begin_; it != end_; ++it)
+			while (first != this->end() && this->func()(*first, item))
 			{
-				if (func(*it))
-				{
-					++cnt;
-				}
+				++first;
 			}
-			if (cnt == 0) throw linq_exception("No value found");
-			else if (cnt != 1) throw linq_exception("More than one value found");
-			auto queryable = Queryable<iterators::single_iter<TIterator, TPredict>>(
-				iterators::single_iter<TIterator, TPredict>(begin_, end_, func),
-				iterators::single_iter<TIterator, TPredict>(end_, end_, func)
-				);
-			return *queryable;
+			return first;
 		}
-		//single_or_default without parameter
-		TElement single_or_default() const
+		TIterator upper_bound(const TIterator& first, const TElement& item, std::true_type) const
 		{
-			auto it = begin_;
-			//empty
-			if (it == end_) return TElement{};
+			return std::upper_bound(first, this->end(), item, this->func());
+		}
+		TIterator upper_bound(TIterator first, const TElement& item, std::false_type) const
+		{
+			while (first != this->end() && !this->func()(item, *first))
+			{
+				++first;
+			}
+			return first;
+		}
 
-			if (++it != end_) throw linq_exception("The collection should have only one value.");
-			return *begin_;
+		template<iterators::merge_operation Operation, typename TList>
+		TMerged<TList, Operation> merge(const TList& l) const
+		{
+			auto q = from(l);
+			if (this->empty() || q.empty()) LINQ_THROW("Empty Collection");
+			using TIterator2 = TOther<TList>;
+			return TMerged<TList, Operation>(
+				iterators::set_merge_iter<TIterator, TIterator2, TComparer, Operation>(this->begin(), this->end(), q.begin(), q.end(), this->func()),
+				iterators::set_merge_iter<TIterator, TIterator2, TComparer, Operation>(this->end(), this->end(), q.end(), q.end(), this->func()),
+				this->func());
 		}
-		//skip
-		Queryable<iterators::skip_iter<TIterator>> skip(int count) const
+	public:
+		SortedQueryable(const TIterator& begin, const TIterator& end, const TComparer& comparer)
+			:TBase(begin, end), func_holder<TComparer>(comparer)
 		{
-			return Queryable<iterators::skip_iter<TIterator>>(
-				iterators::skip_iter<TIterator>(begin_, end_, count),
-				iterators::skip_iter<TIterator>(end_, end_, count)
-				);
+
 		}
-		//skip_while
-		template<typename TPredict>
-		Queryable<iterators::skip_while_iter<TIterator, TPredict>> skip_while(const TPredict& func) const
+
+		const TComparer& comparer() const
 		{
-			return Queryable<iterators::skip_while_iter<TIterator, TPredict>>(
-				iterators::skip_while_iter<TIterator, TPredict>(begin_, end_, func),
-				iterators::skip_while_iter<TIterator, TPredict>(end_, end_, func)
-				);
+			return this->func();
 		}
-		//take
-		Queryable<iterators::take_iter<TIterator>> take(int count) const
+
+		//the overloads with a memory budget keep their external implementations
+		using TBase::distinct;
+		using TBase::except;
+		using TBase::intersect;
+
+		//contains, a binary search on random access sources, a scan that stops at the first greater element otherwise
+		bool contains(const TElement& item) const
 		{
-			return Queryable<iterators::take_iter<TIterator>>(
-				iterators::take_iter<TIterator>(begin_, end_, count),
-				iterators::take_iter<TIterator>(end_, end_, count)
-				);
+			auto iter = lower_bound(this->begin(), item, is_random_access<TIterator>());
+			return iter != this->end() && !this->func()(item, *iter);
 		}
-		//take_while
-		template<typename TPredict>
-		Queryable<iterators::take_while_iter<TIterator, TPredict>> take_while(const TPredict& func) const
+		//equal_range, the elements equivalent to item
+		SortedQueryable equal_range(const TElement& item) const
 		{
-			return Queryable<iterators::take_while_iter<TIterator, TPredict>>(
-				iterators::take_while_iter<TIterator, TPredict>(begin_, end_, func),
-				iterators::take_while_iter<TIterator, TPredict>(end_, end_, func)
-				);
+			auto first = lower_bound(this->begin(), item, is_random_access<TIterator>());
+			return SortedQueryable(first, upper_bound(first, item, is_random_access<TIterator>()), this->func());
 		}
-		//aggregate
-		template<typename TInit, typename TPredict>
-		TInit aggregate(const TInit &init, const TPredict& func) const
+		//range, the elements with low <= element < high
+		SortedQueryable range(const TElement& low, const TElement& high) const
 		{
-			if(empty()) throw linq_exception("Empty Collection");
-			auto result = init;
-			for(auto iter = begin_; iter != end_; ++iter)
-			{
-				result = func(result, *iter);
-			}
-			return result;
+			auto first = lower_bound(this->begin(), low, is_random_access<TIterator>());
+			return SortedQueryable(first, lower_bound(first, high, is_random_access<TIterator>()), this->func());
 		}
-        template<typename TPredict>
-        TElement aggregate(const TPredict& func) const
-        {
-            if(empty()) throw linq_exception("Empty Collection");
-            auto iter = begin_;
-            auto result = *iter;
-            while(++iter != end_)
-            {
-                result = func(result, *iter);
-            }
-            return result;
-        }
-		//average with function
-		template<typename TPredict>
-		TElement average(const TPredict& func) const
+		//distinct, keeps the first of every run of equivalent elements while streaming
+		SortedQueryable<iterators::unique_iter<TIterator, TComparer>, TComparer> distinct() const
 		{
-			if(empty()) throw linq_exception("Empty Collection");
-			TElement sum = 0;
-			int cnt = 0;
-			for(auto iter = begin_; iter != end_; ++iter)
-			{
-				++cnt;
-				sum += func(*iter);
-			}
-			return sum/cnt;
+			if (this->empty()) LINQ_THROW("Empty Collection");
+			return SortedQueryable<iterators::unique_iter<TIterator, TComparer>, TComparer>(
+				iterators::unique_iter<TIterator, TComparer>(this->begin(), this->end(), this->func()),
+				iterators::unique_iter<TIterator, TComparer>(this->end(), this->end(), this->func()),
+				this->func());
 		}
-		//average
-		TElement average() const
+		//except, l has to be sorted by the same comparer and outlive the query
+		template<typename TList>
+		TMerged<TList, iterators::merge_operation::set_difference> except(const TList& l) const
 		{
-			return average([](TElement e){return e;});
+			return merge<iterators::merge_operation::set_difference>(l);
 		}
-		//max
-		TElement max() const
+		//intersect, l has to be sorted by the same comparer and outlive the query
+		template<typename TList>
+		TMerged<TList, iterators::merge_operation::set_intersection> intersect(const TList& l) const
 		{
-			return aggregate([](TElement a, TElement b){return a>b?a:b;});
+			return merge<iterators::merge_operation::set_intersection>(l);
 		}
-		//min
-		TElement min() const
+		//linq_union, l has to be sorted by the same comparer and outlive the query
+		template<typename TList>
+		TMerged<TList, iterators::merge_operation::set_union> linq_union(const TList& l) const
 		{
-			return aggregate([](TElement a, TElement b){return a<b?a:b;});
+			return merge<iterators::merge_operation::set_union>(l);
 		}
-		//sum
-		TElement sum() const
+	};
+
+	//to_index and to_lookup, an immutable open addressing hash index whose elements of one key are contiguous in source order
+	//queries are const and do not allocate, so any number of threads can read one index
+	template<typename TKey, typename TElement>
+	class hash_index
+	{
+	private:
+		struct table
 		{
-			return aggregate([](TElement a, TElement b){return b+a;});
+			std::vector<TKey> keys;
+			//elements of key i are [offsets[i], offsets[i + 1])
+			std::vector<size_t> offsets;
+			std::vector<TElement> elements;
+			//key index + 1, 0 is an empty slot
+			std::vector<std::uint32_t> slots;
+			size_t mask;
+		};
+
+		static const size_t npos = static_cast<size_t>(-1);
+
+		std::shared_ptr<const table> table_;
+
+		//std::hash of integers is the identity, mix it before masking
+		static size_t home(const TKey& key, size_t mask)
+		{
+			unsigned long long h = static_cast<unsigned long long>(std::hash<TKey>()(key)) * 0x9E3779B97F4A7C15ull;
+			return static_cast<size_t>(h ^ (h >> 32)) & mask;
 		}
-		//any
-		template<typename TPredict>
-		bool any(const TPredict& func) const
+
+		static void place(std::vector<std::uint32_t>& slots, size_t mask, const TKey& key, std::uint32_t entry)
 		{
-			for(auto iter = begin_; iter != end_; ++iter)
+			size_t slot = home(key, mask);
+			while (slots[slot] != 0)
 			{
-				if(func(*iter))
-				{
-					return true;
-				}
+				slot = (slot + 1) & mask;
 			}
-			return false;
+			slots[slot] = entry;
 		}
-		//all
-		template<typename TPredict>
-		bool all(const TPredict& func) const
+
+		//at most half of the slots are used
+		static size_t capacity_for(size_t keys)
 		{
-			for(auto iter = begin_; iter != end_; ++iter)
+			size_t capacity = 2;
+			while (capacity < 2 * keys)
 			{
-				if(!func(*iter))
-				{
-					return false;
-				}
+				capacity *= 2;
 			}
-			return true;
+			return capacity;
 		}
-		//count
-		int count() const
+
+		size_t lookup(const TKey& key) const
 		{
-			int cnt = 0;
-			for(auto iter = begin_; iter != end_; ++iter)
+			const table& t = *table_;
+			for (size_t slot = home(key, t.mask);; slot = (slot + 1) & t.mask)
 			{
-				++cnt;
+				std::uint32_t entry = t.slots[slot];
+				if (entry == 0) return npos;
+				if (t.keys[entry - 1] == key) return entry - 1;
 			}
-			return cnt;
 		}
-		//long count
-		long long_count() const
+	public:
+		hash_index()
+			:hash_index(std::vector<TKey>(), std::vector<TElement>())
 		{
-			long cnt = 0;
-			for (auto iter = begin_; iter != end_; ++iter)
-			{
-				++cnt;
-			}
-			return cnt;
+
 		}
-		//sequence equal
-		template<typename TList>
-		bool sequence_equal(const TList &seq) const
+
+		//keys[i] is the key of elements[i]
+		hash_index(std::vector<TKey>&& keys, std::vector<TElement>&& elements)
 		{
-			auto end1 = this->end();
-			auto end2 = std::end(seq);
-            auto it1 = this->begin();
-            auto it2 = std::begin(seq);
-			for (;it1 != end1 && it2 != end2; ++it1, ++it2)
+			auto t = std::make_shared<table>();
+			size_t capacity = capacity_for(keys.size());
+			t->slots.assign(capacity, 0);
+			t->mask = capacity - 1;
+			std::vector<std::uint32_t> ids(keys.size());
+			for (size_t i = 0; i < keys.size(); ++i)
 			{
-				if(*it1 != *it2) return false;
+				size_t slot = home(keys[i], t->mask);
+				for (;; slot = (slot + 1) & t->mask)
+				{
+					std::uint32_t entry = t->slots[slot];
+					if (entry == 0)
+					{
+						if (t->keys.size() >= 0xFFFFFFFEu) LINQ_THROW("Too many keys for an index.");
+						t->keys.push_back(keys[i]);
+						t->slots[slot] = static_cast<std::uint32_t>(t->keys.size());
+						ids[i] = static_cast<std::uint32_t>(t->keys.size() - 1);
+						break;
+					}
+					if (t->keys[entry - 1] == keys[i])
+					{
+						ids[i] = entry - 1;
+						break;
+					}
+				}
 			}
-			return it1 == end1 && it2 == end2;
+			//few distinct keys get a smaller table
+			if (capacity_for(t->keys.size()) < capacity)
+			{
+				capacity = capacity_for(t->keys.size());
+				t->slots.assign(capacity, 0);
+				t->mask = capacity - 1;
+				for (size_t id = 0; id < t->keys.size(); ++id)
+				{
+					place(t->slots, t->mask, t->keys[id], static_cast<std::uint32_t>(id + 1));
+				}
+			}
+			//counting sort by key, stable
+			t->offsets.assign(t->keys.size() + 1, 0);
+			for (auto id : ids)
+			{
+				++t->offsets[id + 1];
+			}
+			for (size_t id = 0; id < t->keys.size(); ++id)
+			{
+				t->offsets[id + 1] += t->offsets[id];
+			}
+			std::vector<size_t> order(elements.size());
+			std::vector<size_t> next(t->offsets.begin(), t->offsets.end() - 1);
+			for (size_t i = 0; i < ids.size(); ++i)
+			{
+				order[next[ids[i]]++] = i;
+			}
+			t->elements.reserve(elements.size());
+			for (auto i : order)
+			{
+				t->elements.push_back(std::move(elements[i]));
+			}
+			table_ = std::move(t);
 		}
 
-        template<typename T>
-        bool sequence_equal(const std::initializer_list<T> &il) const
-        {
-            auto end1 = this->end();
-            auto end2 = std::end(il);
-            auto it1 = this->begin();
-            auto it2 = std::begin(il);
-            for (;it1 != end1 && it2 != end2; ++it1, ++it2)
-            {
-                if(*it1 != *it2) return false;
-            }
-            return it1 == end1 && it2 == end2;
-        }
-		//to vector
-		std::vector<TElement> to_vector() const
+		bool contains(const TKey& key) const
 		{
-			std::vector<TElement> vector;
-			for(auto iter = begin_; iter != end_; ++iter)
-			{
-				vector.emplace_back(*iter);
-			}
-			return vector;
+			return lookup(key) != npos;
 		}
-		//to list
-		std::list<TElement> to_list() const
+
+		//first element of the key, nullptr when it is missing
+		const TElement* find(const TKey& key) const
 		{
-			std::list<TElement> list;
-			for (auto iter = begin_; iter != end_ ; ++iter)
-			{
-				list.emplace_back(*iter);
-			}
-			return list;
+			size_t id = lookup(key);
+			return id == npos ? nullptr : table_->elements.data() + table_->offsets[id];
 		}
-		//to set
-		std::set<TElement> to_set() const
+
+		//elements of the key in source order, the query reads the index and has to be used while the index lives
+		Queryable<const TElement*> equal_range(const TKey& key) const
 		{
-			std::set<TElement> set;
-			for (auto iter = begin_; iter != end_ ; ++iter)
-			{
-				set.insert(*iter);
-			}
-			return set;
+			size_t id = lookup(key);
+			if (id == npos) return Queryable<const TElement*>(nullptr, nullptr);
+			const TElement* data = table_->elements.data();
+			return Queryable<const TElement*>(data + table_->offsets[id], data + table_->offsets[id + 1]);
 		}
-		//to unordered_set
-		std::set<TElement> to_unordered_set() const
+
+		size_t count(const TKey& key) const
 		{
-			std::unordered_set<TElement> set;
-			for (auto iter = begin_; iter != end_ ; ++iter)
-			{
-				set.insert(*iter);
-			}
-			return set;
+			size_t id = lookup(key);
+			return id == npos ? 0 : table_->offsets[id + 1] - table_->offsets[id];
 		}
-		//to map
-		template<typename TPredict1, typename TPredict2>
-		auto to_map(const TPredict1& keySelector, const TPredict2& valueSelector) const -> std::map<decltype(keySelector(*begin_)), decltype(valueSelector(*begin_))>
+
+		//distinct keys in order of first appearance
+		Queryable<const TKey*> keys() const
 		{
-			std::map<decltype(keySelector(*begin_)), decltype(valueSelector(*begin_))> map;
-			for (auto iter = begin_; iter != end_ ; ++iter)
+			return Queryable<const TKey*>(table_->keys.data(), table_->keys.data() + table_->keys.size());
+		}
+
+		size_t size() const
+		{
+			return table_->elements.size();
+		}
+	};
+
+	//to_sorted_index, elements stable sorted by key for binary search and key range queries
+	template<typename TKey, typename TElement>
+	class sorted_index
+	{
+	private:
+		struct table
+		{
+			std::vector<TKey> keys;
+			std::vector<TElement> elements;
+		};
+
+		std::shared_ptr<const table> table_;
+
+		Queryable<const TElement*> slice(typename std::vector<TKey>::const_iterator first, typename std::vector<TKey>::const_iterator last) const
+		{
+			const TElement* data = table_->elements.data();
+			return Queryable<const TElement*>(data + (first - table_->keys.begin()), data + (last - table_->keys.begin()));
+		}
+	public:
+		sorted_index()
+			:sorted_index(std::vector<TKey>(), std::vector<TElement>())
+		{
+
+		}
+
+		//keys[i] is the key of elements[i]
+		sorted_index(std::vector<TKey>&& keys, std::vector<TElement>&& elements)
+		{
+			std::vector<size_t> order(keys.size());
+			for (size_t i = 0; i < order.size(); ++i)
 			{
-				map.insert(std::make_pair(keySelector(*iter), valueSelector(*iter)));
+				order[i] = i;
+			}
+			std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b){return keys[a] < keys[b]; });
+			auto t = std::make_shared<table>();
+			t->keys.reserve(order.size());
+			t->elements.reserve(order.size());
+			for (auto i : order)
+			{
+				t->keys.push_back(std::move(keys[i]));
+				t->elements.push_back(std::move(elements[i]));
 			}
-			return map;
+			table_ = std::move(t);
 		}
-		//concat
-		template<typename TIterator2>
-		Queryable<iterators::concat_iter<TIterator, TIterator2>> concat(const Queryable<TIterator2>& iter2) const
+
+		bool contains(const TKey& key) const
 		{
-			return Queryable<iterators::concat_iter<TIterator, TIterator2>>(
-				iterators::concat_iter<TIterator, TIterator2>(begin_, end_, iter2.begin(), iter2.end()),
-				iterators::concat_iter<TIterator, TIterator2>(end_, end_, iter2.end(), iter2.end())
-				);
+			return std::binary_search(table_->keys.begin(), table_->keys.end(), key);
 		}
-        template<typename TList>
-        auto concat(const TList& list) const -> Queryable<iterators::concat_iter<TIterator, decltype(std::begin(list))>>
-        {
-            using TIterator2 = decltype(std::begin(list));
-            return Queryable<iterators::concat_iter<TIterator, TIterator2>>(
-                iterators::concat_iter<TIterator, TIterator2>(begin_, end_, std::begin(list), std::end(list)),
-                iterators::concat_iter<TIterator, TIterator2>(end_, end_, std::end(list), std::end(list))
-                );
-        }
-		//contains
-		bool contains(const TElement& item) const
+
+		const TElement* find(const TKey& key) const
 		{
-			for (auto iter = begin_; iter != end_; ++iter)
-			{
-				if (*iter == item) return true;
-			}
-			return false;
+			auto iter = std::lower_bound(table_->keys.begin(), table_->keys.end(), key);
+			if (iter == table_->keys.end() || key < *iter) return nullptr;
+			return table_->elements.data() + (iter - table_->keys.begin());
 		}
-		//first without parameter
-		TElement first() const
+
+		Queryable<const TElement*> equal_range(const TKey& key) const
 		{
-			if (empty()) throw linq_exception("empty collection");
-			return *begin_;
+			auto range = std::equal_range(table_->keys.begin(), table_->keys.end(), key);
+			return slice(range.first, range.second);
 		}
 
-		//first with parameter
-		template<typename TPredict>
-		TElement first(const TPredict& func) const
+		//elements with low <= key < high in key order
+		Queryable<const TElement*> range(const TKey& low, const TKey& high) const
 		{
-			if (empty()) throw linq_exception("empty collection");
-			auto iter = begin_;
-			for (auto iter = begin_; iter != end_; ++iter)
-			{
-				if (func(*iter)) return *iter;
-			}
-			throw linq_exception("Not found");
+			auto first = std::lower_bound(table_->keys.begin(), table_->keys.end(), low);
+			auto last = std::lower_bound(first, table_->keys.end(), high);
+			return slice(first, std::max(first, last));
 		}
 
-		//last without parameter
-		TElement last() const
+		//elements with low <= key
+		Queryable<const TElement*> from_key(const TKey& low) const
 		{
-			if (empty()) throw linq_exception("empty collection");
-			TElement ret{};
-			for (auto iter = begin_; iter != end_; ++iter)
-			{
-				ret = *iter;
-			}
-			return ret;
+			return slice(std::lower_bound(table_->keys.begin(), table_->keys.end(), low), table_->keys.end());
 		}
 
-		//last with parameter
-		template<typename TPredict>
-		TElement last(const TPredict& func) const
+		//elements with key < high
+		Queryable<const TElement*> until_key(const TKey& high) const
 		{
-			if (empty()) throw linq_exception("empty collection");
-			TElement ret{};
-			std::vector<TElement> v;
-			for (auto iter = begin_; iter != end_; ++iter)
-			{
-				if (func(*iter)) v.pushback(*iter);
-			}
-			if(v.empty()) throw linq_exception("Not found");
-			return v.back();
+			return slice(table_->keys.begin(), std::lower_bound(table_->keys.begin(), table_->keys.end(), high));
 		}
 
-		//first_or_default without parameter
-		TElement first_or_default() const
+		//keys in order, one per element
+		Queryable<const TKey*> keys() const
 		{
-			if (empty()) return TElement{};
-			return *begin_;
+			return Queryable<const TKey*>(table_->keys.data(), table_->keys.data() + table_->keys.size());
 		}
 
-		//first_or_default with parameter
-		template<typename TPredict>
-		TElement first_or_default(const TPredict& func) const
+		size_t size() const
 		{
-			if (empty()) return TElement{};
-			auto iter = begin_;
-			for (auto iter = begin_; iter != end_; ++iter)
-			{
-				if (func(*iter)) return *iter;
-			}
-			return TElement{};
+			return table_->elements.size();
 		}
+	};
 
-		//last_or_default without parameter
-		TElement last_or_default() const
+#if defined(__unix__) || defined(__APPLE__)
+	//read-only mapping of a file of raw T, such as the output of to_file, from(file) reads it through the page cache
+	template<typename T>
+	class mapped_file
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "mapped_file needs trivially copyable values.");
+	private:
+		std::shared_ptr<void> mapping_;
+		size_t size_;
+	public:
+		mapped_file()
+			:size_(0)
 		{
-			TElement ret{};
-			for (auto iter = begin_; iter != end_; ++iter)
+
+		}
+		explicit mapped_file(const std::string& path)
+			:size_(0)
+		{
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0) LINQ_THROW("Failed to open a file.");
+			struct stat info;
+			if (::fstat(fd, &info) != 0)
 			{
-				ret = *iter;
+				::close(fd);
+				LINQ_THROW("Failed to open a file.");
 			}
-			return ret;
+			size_t bytes = static_cast<size_t>(info.st_size);
+			if (bytes != 0)
+			{
+				void* data = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+				if (data == MAP_FAILED)
+				{
+					::close(fd);
+					LINQ_THROW("Failed to map a file.");
+				}
+				mapping_ = std::shared_ptr<void>(data, [bytes](void* p) { ::munmap(p, bytes); });
+			}
+			::close(fd);
+			size_ = bytes / sizeof(T);
 		}
 
-		//last_or_default with parameter
-		template<typename TPredict>
-		TElement last_or_default(const TPredict& func) const
+		const T* begin() const
 		{
-			TElement ret{};
-			for (auto iter = begin_; iter != end_; ++iter)
-			{
-				if (func(*iter)) ret = *iter;
-			}
-			return ret;
+			return static_cast<const T*>(mapping_.get());
 		}
-		//empty
-		inline bool empty() const
+
+		const T* end() const
 		{
-			return begin_ == end_;
+			return begin() + size_;
 		}
-		//default_if_empty without parameter
-		Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>> default_if_empty() const
+
+		size_t size() const
 		{
-			return default_if_empty(TElement());
+			return size_;
 		}
+	};
+#endif
 
-		//default_if_empty with parameter
-		Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>> default_if_empty(const TElement& default_value) const
+#if defined(__linux__)
+	//partitioned execution in forked worker processes on one machine, results come back through shared memory
+	//workers inherit the parent's memory copy on write, so any random access source works and mapped files are shared
+	//a crashed worker fails the call instead of the parent; fork the workers before other threads hold locks
+	namespace processes
+	{
+		//an in-memory file the worker writes its serialized result to
+		class shared_region
 		{
-			auto p = std::make_shared<std::vector<TElement>>();
-			if (empty())
+		private:
+			int fd_;
+		public:
+			shared_region()
 			{
-				p->push_back(default_value);
+#ifdef MFD_CLOEXEC
+				fd_ = ::memfd_create("cpplinq-worker", MFD_CLOEXEC);
+#else
+				spill::spill_file file(memory_budget{ 0, "/dev/shm" });
+				fd_ = ::open(file.path().c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+#endif
+				if (fd_ < 0) LINQ_THROW("Failed to create shared memory.");
 			}
-			else
+
+			shared_region(const shared_region&) = delete;
+			shared_region& operator=(const shared_region&) = delete;
+
+			~shared_region()
 			{
-				for (auto iter = begin_; iter != end_; ++iter)
+				::close(fd_);
+			}
+
+			int fd() const
+			{
+				return fd_;
+			}
+
+			//maps the region and deserializes one T
+			template<typename T>
+			T read() const
+			{
+				struct stat info;
+				if (::fstat(fd_, &info) != 0) LINQ_THROW("Failed to read shared memory.");
+				size_t bytes = static_cast<size_t>(info.st_size);
+				void* data = bytes == 0 ? nullptr : ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd_, 0);
+				if (data == MAP_FAILED) LINQ_THROW("Failed to read shared memory.");
+				std::shared_ptr<void> mapping(data, [bytes](void* p) { if (p != nullptr) ::munmap(p, bytes); });
+				struct
 				{
-					p->push_back(*iter);
-				}
+					const char* data;
+					size_t size;
+					bool read(void* out, size_t n)
+					{
+						if (n > size) return false;
+						if (n != 0) std::memcpy(out, data, n);
+						data += n;
+						size -= n;
+						return true;
+					}
+				} stream = { static_cast<const char*>(data), bytes };
+				T value;
+				if (!serializer<T>::read(stream, value)) LINQ_THROW("A worker process returned a truncated result.");
+				return value;
 			}
-			return Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>>(
-				iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>(p, p->begin(), p->end()),
-				iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>(p, p->end(), p->end())
-				);
-		}
-		//element_at
-		TElement element_at(int index) const
+		};
+
+		class executor
 		{
-			if(index >= 0)
+		private:
+			size_t workers_;
+		public:
+			//0 uses every hardware thread
+			explicit executor(size_t workers = 0)
+				:workers_(workers == 0 ? parallel::concurrency(execution::par) : workers)
+			{
+
+			}
+
+			size_t workers() const
+			{
+				return workers_;
+			}
+
+			//func(part) runs in one worker per contiguous part of a random access source, the results are returned in part order
+			//results are serialized with serializer<R>
+			template<typename TIterator, typename TFunc>
+			auto map(const Queryable<TIterator>& source, const TFunc& func) const
+				-> std::vector<clean_type<decltype(func(source))>>
 			{
-				int count = 0;
-				for(auto iter = begin_; iter != end_; ++iter)
+				static_assert(is_random_access<TIterator>::value, "processes::executor needs a random access source.");
+				typedef clean_type<decltype(func(source))> TResult;
+				size_t size = static_cast<size_t>(source.end() - source.begin());
+				size_t workers = std::max<size_t>(1, std::min(workers_, size));
+				std::vector<std::unique_ptr<shared_region>> regions;
+				for (size_t worker = 0; worker < workers; ++worker)
+				{
+					regions.emplace_back(new shared_region());
+				}
+				std::cout.flush();
+				std::cerr.flush();
+				std::vector<pid_t> pids;
+				bool failed = false;
+				for (size_t worker = 0; worker < workers && !failed; ++worker)
+				{
+					pid_t pid = ::fork();
+					if (pid < 0)
+					{
+						failed = true;
+					}
+					else if (pid == 0)
+					{
+						int code = 0;
+						LINQ_TRY
+						{
+							auto first = source.begin() + static_cast<std::ptrdiff_t>(size * worker / workers);
+							auto last = source.begin() + static_cast<std::ptrdiff_t>(size * (worker + 1) / workers);
+							TResult result = func(Queryable<TIterator>(first, last));
+							io::block_writer<io::file_sink> writer(io::write_options(), ::dup(regions[worker]->fd()));
+							serializer<TResult>::write(writer, result);
+							writer.close();
+						}
+						LINQ_CATCH_ALL
+						{
+							code = 1;
+						}
+						::_exit(code);
+					}
+					else
+					{
+						pids.push_back(pid);
+					}
+				}
+				for (pid_t pid : pids)
+				{
+					int status = 0;
+					pid_t waited;
+					while ((waited = ::waitpid(pid, &status, 0)) < 0 && errno == EINTR);
+					//a worker that cannot be waited for is a failed one
+					if (waited != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = true;
+				}
+				if (failed) LINQ_THROW("A worker process failed.");
+				std::vector<TResult> results;
+				results.reserve(workers);
+				for (auto& region : regions)
 				{
-					if(count == index) return *iter;
-					++count;
+					results.push_back(region->template read<TResult>());
 				}
+				return results;
 			}
-			throw linq_exception("Index out of range");
-		}
-		//element_at_or_default
-		TElement element_at_or_default(int index) const
-		{
-			if(index >= 0)
+
+			//partial aggregates of every part folded in part order with combine(a, b)
+			template<typename TIterator, typename TFunc, typename TCombine>
+			auto aggregate(const Queryable<TIterator>& source, const TFunc& func, const TCombine& combine) const
+				-> clean_type<decltype(func(source))>
 			{
-				int count = 0;
-				for(auto iter = begin_; iter != end_; ++iter)
+				auto partials = map(source, func);
+				auto result = std::move(partials.front());
+				for (size_t i = 1; i < partials.size(); ++i)
 				{
-					if(count == index) return *iter;
-					++count;
+					result = combine(result, partials[i]);
 				}
+				return result;
 			}
-			return TElement{};
-		}
-		//distinct
-		Queryable<iterators::adapter_iter<std::shared_ptr<std::set<TElement>>>> distinct() const
-		{
-			if (empty()) throw linq_exception("Empty Collection");
-			auto set = std::make_shared<std::set<TElement>>();
-			for (auto iter = begin_; iter != end_; ++iter)
+
+			//the vectors of every part concatenated in part order
+			template<typename TIterator, typename TFunc>
+			auto collect(const Queryable<TIterator>& source, const TFunc& func) const
+				-> clean_type<decltype(func(source))>
 			{
-				set->insert(*iter);
+				auto parts = map(source, func);
+				auto result = std::move(parts.front());
+				for (size_t i = 1; i < parts.size(); ++i)
+				{
+					std::move(parts[i].begin(), parts[i].end(), std::back_inserter(result));
+				}
+				return result;
 			}
-			return Queryable<iterators::adapter_iter<std::shared_ptr<std::set<TElement>>>>(
-				iterators::adapter_iter<std::shared_ptr<std::set<TElement>>>(set, set->begin(), set->end()),
-				iterators::adapter_iter<std::shared_ptr<std::set<TElement>>>(set, set->end(), set->end())
-				);
-		}
-		//except
-		template<typename TList>
-		Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>> except(const TList& l) const
-		{
-            auto q = from(l);
-			if(empty() || q.empty()) throw linq_exception("Empty Collection");
-			auto v = std::make_shared<std::vector<TElement>>();
-			std::set<TElement> set_ex(q.begin(), q.end());
-			for (auto iter = begin_; iter != end_; ++iter)
+
+			//every part returns a vector sorted by comparer, the runs are merged and equal elements keep part order
+			template<typename TIterator, typename TFunc, typename TComparer>
+			auto merge_sorted(const Queryable<TIterator>& source, const TFunc& func, const TComparer& comparer) const
+				-> clean_type<decltype(func(source))>
 			{
-				//if element is not in exclude set
-				if (set_ex.insert(*iter).second)
+				auto runs = map(source, func);
+				auto result = std::move(runs.front());
+				for (size_t i = 1; i < runs.size(); ++i)
 				{
-					v->push_back(*iter);
+					size_t middle = result.size();
+					std::move(runs[i].begin(), runs[i].end(), std::back_inserter(result));
+					std::inplace_merge(result.begin(), result.begin() + static_cast<std::ptrdiff_t>(middle), result.end(), comparer);
 				}
+				return result;
 			}
-			return Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>>(
-				iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>(v, v->begin(), v->end()),
-				iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>(v, v->end(), v->end())
-				);
-		}
-		//intersect
-		template<typename TList>
-		Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>> intersect(const TList& l) const
-		{
-            auto q = from(l);
-			if (empty() || q.empty()) throw linq_exception("Empty Collection");
-			auto v = std::make_shared<std::vector<TElement>>(std::distance(q.begin(), q.end()));
-            std::set<TElement> set1(begin_, end_);
-			std::set<TElement> set2(q.begin(), q.end());
-            auto it = std::set_intersection(set1.begin(), set1.end(), set2.begin(), set2.end(), v->begin());
-            v->resize(it-v->begin());
-			return Queryable<iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>>(
-				iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>(v, v->begin(), v->end()),
-				iterators::adapter_iter<std::shared_ptr<std::vector<TElement>>>(v, v->end(), v->end())
-				);
-		}
-		//union, use linq_union to avoid key word union
-		template<typename TList>
-		Queryable<iterators::adapter_iter<std::shared_ptr<std::set<TElement>>>> linq_union(const TList& l) const
-		{
-            auto q = from(l);
-			if (empty() || q.empty()) throw linq_exception("Empty Collection");
-			return concat(q).distinct();
-		}
-		//zip
-        template<typename TList>
-		auto zip(const TList& l) const ->Queryable<iterators::zip_iter<TIterator, decltype(std::begin(l))>> const
-		{
-            using TIterator2 = decltype(std::begin(l));
-			return Queryable<iterators::zip_iter<TIterator, TIterator2>>(
-				iterators::zip_iter<TIterator, TIterator2>(begin_, end_, std::begin(l), std::end(l)),
-				iterators::zip_iter<TIterator, TIterator2>(end_, end_, std::end(l), std::end(l)));
-		}
-		//order_by
-        template<typename TPredict>
-        auto order_by(const TPredict& keySelector) const
-        {
-            using TKey = decltype(keySelector(*(TElement*)0));
-            auto g = group_by(keySelector);
-            return from_values(g).select_many([](const std::vector<TElement> &v) {return v;});
-        }
-		//group_by
-		template<typename TPredict>
-		auto group_by(const TPredict& keySelector) const -> std::vector<std::vector<TElement>> const
-		{
-			return group_by(keySelector, [](const TElement &ele) {return ele; });
-		}
-		//group_by with value selector
-		template<typename TPredict1, typename TPredict2>
-		auto group_by(const TPredict1& keySelector, const TPredict2& valueSelector) const -> std::vector<std::vector<decltype(valueSelector(*(TElement*)0))>> const
-		{
-			using TKey = decltype(keySelector(*(TElement*)0));
-			using TValue = decltype(valueSelector(*(TElement*)0));
-            std::vector<std::vector<TValue>> vv;
-            std::map<TKey, std::vector<TValue>> m;
 
-			for (auto iter = begin_; iter != end_; ++iter)
+			//every part returns (key, value) pairs sorted by key like group_aggregate, values of equal keys are combined in part order
+			template<typename TIterator, typename TFunc, typename TCombine>
+			auto merge_groups(const Queryable<TIterator>& source, const TFunc& func, const TCombine& combine) const
+				-> clean_type<decltype(func(source))>
 			{
-                auto key = keySelector(*iter);
-                auto value = valueSelector(*iter);
-                if(m.find(key) != m.end())
-                {
-                    auto &v = m[key];
-                    v.push_back(value);
-                }
-                else
-                {
-                    std::vector<TValue> v;
-                    v.push_back(value);
-                    m.insert(std::make_pair(key, v));
-                }
+				typedef typename clean_type<decltype(func(source))>::value_type TPair;
+				auto merged = merge_sorted(source, func, [](const TPair& a, const TPair& b){return a.first < b.first; });
+				clean_type<decltype(func(source))> result;
+				for (auto& entry : merged)
+				{
+					if (!result.empty() && !(result.back().first < entry.first))
+					{
+						result.back().second = combine(result.back().second, entry.second);
+					}
+					else
+					{
+						result.push_back(std::move(entry));
+					}
+				}
+				return result;
 			}
-            for(auto& p : m)
-            {
-                vv.push_back(p.second);
-            }
-            return vv;
-		}
-		//join
-		//group_join
-	};
+		};
+	}
+#endif
 }
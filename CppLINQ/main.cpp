@@ -8,8 +8,26 @@
 #include <string>
 #include <assert.h>
 #include <algorithm>
+#include <list>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <sstream>
+#include <fstream>
+#include <cstring>
 
 using namespace	LL;
+struct person
+{
+    std::string name;
+};
+
+struct pet
+{
+    std::string name;
+    person owner;
+};
+
 struct PetOwner
 {
     PetOwner() = default;
@@ -20,6 +38,67 @@ struct PetOwner
     std::vector<int> num_;
 };
 
+//counts the comparisons of the ordered sets inside the set operators
+struct compared
+{
+    int value;
+    static size_t comparisons;
+    bool operator<(const compared& other) const
+    {
+        ++comparisons;
+        return value < other.value;
+    }
+    bool operator==(const compared& other) const
+    {
+        return value == other.value;
+    }
+};
+size_t compared::comparisons = 0;
+
+namespace std
+{
+    template<>
+    struct hash<compared>
+    {
+        size_t operator()(const compared& c) const
+        {
+            return hash<int>()(c.value);
+        }
+    };
+}
+
+#if __cplusplus >= 201703L
+//////////////////////////////////////////////////////////////////
+// compile time evaluation
+//////////////////////////////////////////////////////////////////
+constexpr int cxs[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+constexpr int cys[] = { 10, 20, 30 };
+
+static_assert(from(cxs).where([](int x){return x % 2 == 1; }).select([](int x){return x * x; }).sum() == 165, "where/select/sum");
+static_assert(from(cxs).skip(2).take(3).count() == 3, "skip/take/count");
+static_assert(from(cxs).take_while([](int x){return x < 4; }).max() == 3, "take_while/max");
+static_assert(from(cxs).skip_while([](int x){return x < 4; }).min() == 4, "skip_while/min");
+static_assert(from(cys).concat(from(cxs)).first() == 10, "concat/first");
+static_assert(from(cxs).take(3).zip(cys).select([](std::pair<int, int> p){return p.first * p.second; }).sum() == 140, "zip");
+static_assert(from(cxs).aggregate(1, [](int a, int b){return a * b; }) == 3628800, "aggregate");
+static_assert(from(cxs).all([](int x){return x > 0; }) && from(cxs).any([](int x){return x > 9; }), "all/any");
+static_assert(from(cxs).contains(7) && !from(cys).contains(7), "contains");
+static_assert(from(cxs).first([](int x){return x > 5; }) == 6, "first");
+
+constexpr std::array<int, 5> make_square_table()
+{
+	std::array<int, 5> table{};
+	size_t i = 0;
+	for (auto x : from(cxs).select([](int x){return x * x; }).take(5))
+	{
+		table[i++] = x;
+	}
+	return table;
+}
+constexpr auto square_table = make_square_table();
+static_assert(square_table[4] == 25, "table");
+#endif
+
 void test()
 {
 	//////////////////////////////////////////////////////////////////
@@ -66,6 +145,28 @@ void test()
 		int xs[] = { 1, 2, 3, 4, 5 };
 		assert(from(xs).where([](int x){return x % 2 == 0; }).sequence_equal({ 2, 4 }));
 	}
+	{
+		std::vector<int> xs(5000);
+		for (int i = 0; i < 5000; i++) xs[i] = (i * 7919) % 1000;
+		auto odd = [](int x){return x % 2 == 1; };
+		assert(from(xs).where_vectorized(odd).sequence_equal(from(xs).where(odd)));
+		assert(from(xs).where_vectorized(odd).count() == from(xs).where(odd).count());
+		assert(from(xs).where_vectorized([](int x){return x >= 998; }).select([](int x){return x - 998; }).sum() == 5);
+		assert(from(xs).where_vectorized([](int x){return x < 0; }).empty());
+		assert(from(xs).where_vectorized([](int x){return x < 0; }).count() == 0);
+		assert(from(xs).skip(4095).where_vectorized([](int x){return x == (4095 * 7919) % 1000; }).first() == (4095 * 7919) % 1000);
+		auto odds = from(xs).where_vectorized(odd);
+		auto kept = odds.begin();
+		auto moved = kept;
+		for (int i = 0; i < 2000; i++) ++moved;
+		assert(*kept == from(xs).where(odd).first() && *moved == from(xs).where(odd).element_at(2000));
+		assert(std::equal(kept, moved, from(xs).where(odd).begin()));
+
+		double ys[] = { 0.5, 2.5, 1.5, 3.5 };
+		assert(from(ys).where_vectorized([](double y){return y > 1.0; }).sequence_equal({ 2.5, 1.5, 3.5 }));
+		std::vector<int> ids = { 1, 2, 3, 4 };
+		assert(from_columns(ids, ys).select(column<1>()).where_vectorized([](double y){return y < 2.0; }).count() == 2);
+	}
 	//////////////////////////////////////////////////////////////////
 	// iterating
 	//////////////////////////////////////////////////////////////////
@@ -88,6 +189,30 @@ void test()
 		assert(from(xs).concat(empty).sequence_equal(xs));
 		assert(from(empty).concat(xs).sequence_equal(xs));
 		assert(from(empty).concat(empty).sequence_equal(empty));
+
+		static_assert(std::is_same<decltype(from(xs).skip(1).take(3)), decltype(from(xs))>::value, "random access skip and take slice the source");
+		assert(from(xs).skip(1).take(3).sequence_equal({ 2, 3, 4 }));
+		assert(from(xs).skip(9).empty());
+		assert(from(xs).take(9).sequence_equal(xs));
+		std::list<int> ls = { 1, 2, 3, 4, 5 };
+		static_assert(std::is_same<decltype(from(ls).take(4).take(2)), decltype(from(ls).take(2))>::value, "nested take");
+		static_assert(std::is_same<decltype(from(ls).skip(1).skip(2)), decltype(from(ls).skip(3))>::value, "nested skip");
+		assert(from(ls).take(4).take(2).sequence_equal({ 1, 2 }));
+		assert(from(ls).take(2).take(4).sequence_equal({ 1, 2 }));
+		assert(from(ls).skip(1).skip(2).sequence_equal(zs));
+		assert(from(ls).skip(1).take(3).skip(1).sequence_equal({ 3, 4 }));
+		auto even = [](int x){return x % 2 == 0; };
+		auto small = [](int x){return x < 4; };
+		static_assert(std::is_same<decltype(from(ls).where(even).where(small).begin()), iterators::where_iter<std::list<int>::const_iterator, and_predicate<decltype(even), decltype(small)>>>::value, "adjacent where");
+		assert(from(ls).where(even).where(small).sequence_equal({ 2 }));
+		assert(from(ls).where(small).where(even).where(small).count() == 1);
+
+		//only the innermost source keeps an end, stateless lambdas take no space
+		std::vector<int> vs = { 1, 2, 3, 4, 5 };
+		auto deep = from(vs).where(even).select([](int x){return x * 3; }).skip_while(small).select([](int x){return x + 1; });
+		static_assert(sizeof(deep.begin()) == 2 * sizeof(std::vector<int>::const_iterator), "adapters grow linearly");
+		assert(deep.sequence_equal({ 7, 13 }));
+		assert(deep.take_while([](int x){return x < 10; }).sequence_equal({ 7 }));
 	}
 	//////////////////////////////////////////////////////////////////
 	// counting
@@ -101,6 +226,7 @@ void test()
 		int f[] = { 6, 7, 8, 9, 10 };
 		int g[] = { 0 };
 		assert(from(a).sequence_equal(b));
+		assert(!from(a).sequence_equal(d) && !from(a).sequence_equal(e) && !from(a).sequence_equal(f));
 
 		assert(from(a).contains(1));
 		assert(from(a).contains(5));
@@ -109,6 +235,16 @@ void test()
 
 		assert(from(a).count() == 5);
 		assert(from(c).count() == 0);
+		int calls = 0;
+		auto square = [&calls](int x){ ++calls; return x * x; };
+		assert(from(a).select(square).count() == 5);
+		assert(from(a).select(square).any());
+		assert(!from(c).select(square).any());
+		assert(!from(a).select(square).empty());
+		assert(calls == 0);
+		assert(from(a).where([](int x){return x > 2; }).count() == 3);
+		assert(from(a).element_at_or_default(4) == 5);
+		assert(from(a).element_at_or_default(5) == 0);
 
 		assert(from(a).default_if_empty(0).sequence_equal(b));
 		assert(from(c).default_if_empty(0).sequence_equal(g));
@@ -144,6 +280,50 @@ void test()
 		catch (const linq_exception&){}
 		try{ from(c).single(); assert(false); }
 		catch (const linq_exception&){}
+
+#if __cplusplus >= 201703L
+		assert(from(a).try_first() == 1 && !from(c).try_first());
+		assert(from(a).try_first([](int x){return x > 3; }) == 4 && !from(a).try_first([](int x){return x > 5; }));
+		assert(from(a).try_last() == 5 && !from(c).try_last());
+		assert(from(a).where([](int x){return x < 3; }).try_last() == 2);
+		assert(from(a).try_last([](int x){return x % 2 == 0; }) == 4 && !from(c).try_last([](int){return true; }));
+		assert(from(g).try_single() == 0 && !from(a).try_single() && !from(c).try_single());
+		assert(from(a).try_single([](int x){return x == 3; }) == 3);
+		assert(!from(a).try_single([](int x){return x > 3; }) && !from(a).try_single([](int x){return x > 5; }));
+		assert(from(a).try_element_at(4) == 5 && !from(a).try_element_at(5) && !from(c).try_element_at(0));
+		assert(from(a).try_min() == 1 && from(a).try_max() == 5 && !from(c).try_min() && !from(c).try_max());
+		assert(from(a).try_average() == 3.0 && !from(c).try_average());
+		assert(from(a).try_average([](int x){return x * 2.0; }) == 6.0);
+		assert(from(a).try_aggregate([](int x, int y){return x * y; }) == 120 && !from(c).try_aggregate([](int x, int y){return x * y; }));
+#endif
+		try{ from(c).first(); assert(false); }
+		catch (const std::exception& e){ assert(std::string(e.what()) == "empty collection"); }
+		assert(std::string(linq_exception(std::string("owned")).what()) == "owned");
+
+		std::vector<PetOwner> owners{ PetOwner("higa", { "scruffy", "sam" }, { 10 }), PetOwner("ronen", { "walker" }, { 40, 50 }), PetOwner("ann", {}, {}) };
+		auto has_pets = [](const PetOwner& o){return !o.pets_.empty(); };
+		assert(&from(owners).first() == &owners[0] && &from(owners).first(has_pets) == &owners[0]);
+		assert(&from(owners).last() == &owners[2] && &from(owners).last(has_pets) == &owners[1]);
+		assert(&from(owners).single([](const PetOwner& o){return o.name_ == "ann"; }) == &owners[2]);
+		try{ from(owners).single(has_pets); assert(false); }
+		catch (const linq_exception&){}
+		assert(&from(owners).element_at(1) == &owners[1] && &from(owners).where(has_pets).element_at(1) == &owners[1]);
+		assert(&from(owners).where(has_pets).last() == &owners[1]);
+		assert(&from(owners).order_by([](const PetOwner& o){return o.name_; }).first() == &owners[2]);
+		const auto& distinct_first = from(b).distinct().first();
+		const auto& ordered_last = from(owners).order_by([](const PetOwner& o){return o.name_; }).last();
+		const auto& buffered_last = from(b).default_if_empty().last([](int x){return x < 3; });
+		assert(distinct_first == 1 && ordered_last.name_ == "ronen" && buffered_last == 2);
+		std::list<PetOwner> listed(owners.begin(), owners.end());
+		assert(&from(listed).last() == &listed.back());
+		linq<const PetOwner&> refs = from(owners).where(has_pets);
+		assert(&refs.first() == &owners[0] && &refs.last() == &owners[1] && refs.count() == 2);
+		assert(&*refs.begin() == &owners[0] && refs.select([](const PetOwner& o){return o.num_.size(); }).sequence_equal({ 1u, 2u }));
+		auto pairs = from(owners).zip_ref(listed).to_vector();
+		assert(&pairs[2].first.get() == &owners[2] && &pairs[2].second.get() == &listed.back());
+		assert(from(a).select([](int x){return x * 2; }).last() == 10 && from(a).select([](int x){return x; }).single([](int x){return x == 3; }) == 3);
+		int h[] = { 3 };
+		assert(from(a).concat(from(h).select([](int x){return x * 2; })).sequence_equal({ 1, 2, 3, 4, 5, 6 }));
 	}
 	//////////////////////////////////////////////////////////////////
 	// containers
@@ -157,6 +337,91 @@ void test()
 		auto f = [](int x){return x; };
 		assert(from(xs).sequence_equal(from(from(xs).to_map(f, f)).select([](std::pair<int, int> p){return p.first; })));
 		assert(from(xs).sequence_equal(from(from(xs).to_map(f, f)).select([](std::pair<int, int> p){return p.second; })));
+
+		std::ostringstream out;
+		assert(from(xs).where([](int x){return x % 2 == 1; }).to_stream(out) == 3);
+		int odd[3];
+		assert(out.str().size() == sizeof(odd));
+		std::memcpy(odd, out.str().data(), sizeof(odd));
+		assert(from(odd).sequence_equal({ 1, 3, 5 }));
+
+		std::ostringstream text;
+		std::vector<std::string> words = { "ab", "", "cde" };
+		assert(from(words).to_stream(text, [](auto& writer, const std::string& s){ writer.write(s.data(), s.size()); writer.write("\n", 1); }) == 3);
+		assert(text.str() == "ab\n\ncde\n");
+		std::ostringstream prefixed;
+		from(words).to_stream(prefixed);
+		assert(prefixed.str().size() == 3 * sizeof(size_t) + 5);
+
+		std::vector<long long> rows(300000);
+		std::iota(rows.begin(), rows.end(), 0LL);
+		std::string path = spill::temp_directory(memory_budget{ 0 }) + "/cpplinq-to_file.bin";
+		io::write_options options;
+		options.buffer_size = 10000;
+		for (bool direct : { false, true })
+		{
+			options.direct = direct;
+			for (size_t n : { rows.size(), rows.size() - 3 })
+			{
+				assert(from(rows).take(n).to_file(path, options) == n);
+				assert(from(rows).take(n).select([](long long x){return x; }).to_file(path, options) == n);
+				std::ifstream in(path, std::ios::binary);
+				std::vector<long long> back(n + 1);
+				in.read(reinterpret_cast<char*>(back.data()), static_cast<std::streamsize>(back.size() * sizeof(long long)));
+				assert(static_cast<size_t>(in.gcount()) == n * sizeof(long long));
+				back.pop_back();
+				assert(from(back).sequence_equal(from(rows).take(n)));
+			}
+		}
+		std::remove(path.c_str());
+		try{ from(xs).to_file("/nonexistent-cpplinq-dir/out.bin"); assert(false); }
+		catch (const linq_exception&){}
+
+		std::vector<std::string> names = { "ann", "bob", "amy", "cal", "al", "bea" };
+		auto first_letter = [](const std::string& s){return s[0]; };
+		auto by_letter = from(names).to_index(first_letter);
+		assert(by_letter.size() == 6);
+		assert(by_letter.keys().sequence_equal({ 'a', 'b', 'c' }));
+		assert(by_letter.contains('b') && !by_letter.contains('z'));
+		assert(*by_letter.find('c') == "cal" && by_letter.find('z') == nullptr);
+		assert(by_letter.equal_range('a').sequence_equal({ std::string("ann"), std::string("amy"), std::string("al") }));
+		assert(by_letter.equal_range('z').count() == 0 && by_letter.count('b') == 2);
+		auto lengths = from(names).to_lookup(first_letter, [](const std::string& s){return s.size(); });
+		assert(lengths.equal_range('a').sequence_equal({ 3u, 3u, 2u }));
+
+		std::vector<int> many(100000);
+		std::iota(many.begin(), many.end(), 0);
+		auto mod = from(many).to_index([](int x){return x % 1000; });
+		std::vector<std::thread> readers;
+		for (int t = 0; t < 4; t++)
+		{
+			readers.emplace_back([&mod, t]()
+			{
+				for (int k = t; k < 1000; k += 4)
+				{
+					assert(mod.count(k) == 100 && *mod.find(k) == k);
+					std::vector<int> expected;
+					for (int i = 0; i < 100; i++) expected.push_back(i * 1000 + k);
+					assert(mod.equal_range(k).sequence_equal(expected));
+				}
+				assert(!mod.contains(1000) && !mod.contains(-1));
+			});
+		}
+		for (auto& reader : readers)
+		{
+			reader.join();
+		}
+		assert(from(many).to_index([](int x){return x; }).keys().count() == many.size());
+
+		auto sorted = from(names).to_sorted_index([](const std::string& s){return s.size(); });
+		assert(sorted.keys().sequence_equal({ 2u, 3u, 3u, 3u, 3u, 3u }));
+		assert(*sorted.find(2) == "al" && sorted.find(4) == nullptr && sorted.contains(3));
+		assert(sorted.equal_range(3).sequence_equal(from(names).where([](const std::string& s){return s.size() == 3; })));
+		auto years = from(many).to_sorted_index([](int x){return (x * 7877) % 100000; });
+		assert(years.range(10, 20).select([](int x){return (x * 7877) % 100000; }).sequence_equal({ 10, 11, 12, 13, 14, 15, 16, 17, 18, 19 }));
+		assert(years.range(20, 10).count() == 0 && years.from_key(99990).count() == 10 && years.until_key(5).count() == 5);
+		assert(from(std::vector<int>()).to_sorted_index([](int x){return x; }).range(0, 10).count() == 0);
+		assert(!from(std::vector<int>()).to_index([](int x){return x; }).contains(0));
 	}
 	//////////////////////////////////////////////////////////////////
 	// aggregating
@@ -184,6 +449,77 @@ void test()
 		try{ from(ys).average(); assert(false); }
 		catch (const linq_exception&){}
 	}
+	{
+		int xs[] = { 1, 2, 3, 4, 5 };
+		auto plus = [](int a, int b){return a + b; };
+		assert(from(xs).scan(0, plus).sequence_equal({ 1, 3, 6, 10, 15 }));
+		assert(from(xs).scan(100, [](int a, int b){return a - b; }).sequence_equal({ 99, 97, 94, 90, 85 }));
+		assert(from(xs).where([](int x){return x > 5; }).scan(0, plus).empty());
+		assert(from(xs).scan(10, plus).sequence_equal(from(xs).scan(execution::par, 10, plus)));
+
+		std::vector<long long> volumes;
+		for (int i = 0; i < 100000; ++i)
+		{
+			volumes.push_back(i % 17);
+		}
+		auto add = [](long long a, long long b){return a + b; };
+		auto serial = from(volumes).scan(5LL, add).to_vector();
+		assert(serial.back() == from(volumes).sum() + 5);
+		assert(from(volumes).scan(execution::par, 5LL, add).sequence_equal(serial));
+		assert(from(volumes).where([](long long x){return x != 3; }).scan(execution::par.with_concurrency(4), 0LL, add)
+			.sequence_equal(from(volumes).where([](long long x){return x != 3; }).scan(0LL, add)));
+	}
+	{
+		int xs[] = { 2, 4, 4, 4, 5, 5, 7, 9 };
+		int calls = 0;
+		auto q = from(xs).where([&](int x){++calls; return x > 2; });
+		auto r = q.aggregate_many(count_of(), sum_of(), min_of(), max_of([](int x){return -x; }), average_of());
+		assert(calls == 8);
+		assert(std::get<0>(r) == 7 && std::get<1>(r) == 38 && std::get<2>(r) == 4 && std::get<3>(r) == -4);
+		assert(std::get<4>(r) > 5.42 && std::get<4>(r) < 5.43);
+		assert(from({ 1, 2 }).average() == 1.5);
+
+		auto s = from(xs).stats();
+		assert(s.count == 8 && s.sum == 40 && s.min == 2 && s.max == 9 && s.mean == 5 && s.variance == 4);
+		try{ from(std::vector<int>()).stats(); assert(false); }
+		catch (const linq_exception&){}
+		assert(std::get<0>(from(std::vector<int>()).aggregate_many(count_of())) == 0);
+
+		std::vector<double> samples;
+		for (int i = 0; i < 100000; ++i)
+		{
+			samples.push_back((i * 37) % 101);
+		}
+		auto serial = from(samples).stats();
+		auto parallel = from(samples).stats(execution::par.with_concurrency(4));
+		assert(serial.count == parallel.count && serial.sum == parallel.sum && serial.min == parallel.min && serial.max == parallel.max);
+		assert(std::abs(serial.mean - parallel.mean) < 1e-9 && std::abs(serial.variance - parallel.variance) < 1e-6);
+		auto pr = from(samples).where([](double x){return x > 50; }).aggregate_many(execution::par, count_of(), sum_of([](double x){return x * 2; }));
+		assert(std::get<0>(pr) == from(samples).where([](double x){return x > 50; }).count());
+		assert(std::get<1>(pr) == from(samples).where([](double x){return x > 50; }).sum() * 2);
+	}
+	{
+		std::vector<float> xs(1000000, 0.1f);
+		double expected = 1000000 * static_cast<double>(0.1f);
+		assert(std::abs(from(xs).sum() - expected) > 100);
+		assert(std::abs(from(xs).sum(summation::pairwise) - expected) < 0.05);
+		assert(std::abs(from(xs).sum(summation::kahan) - expected) < 0.05);
+		assert(std::abs(from(xs).sum(summation::neumaier) - expected) < 0.05);
+		assert(std::abs(from(xs).sum(summation::widened) - expected) < 1e-6);
+		assert(std::abs(from(xs).where([](float x){return x > 0; }).average(summation::kahan) - 0.1) < 1e-6);
+
+		std::vector<double> ys = { 1.0, 1e100, 1.0, -1e100 };
+		assert(from(ys).sum(summation::neumaier) == 2.0);
+		assert(from({ 1.5, 2.5, 3.0 }).sum(summation::naive) == 7.0);
+
+		std::vector<int> zs = { 2147483647, 1 };
+		assert(from(zs).sum(summation::widened) == 2147483648LL);
+		assert(from(zs).average(summation::widened) == 1073741824.0);
+		int evaluated = 0;
+		auto traced = [&evaluated](int x){ ++evaluated; return static_cast<double>(x); };
+		assert(from({ 1, 2, 3, 4 }).select(traced).average(summation::kahan) == 2.5 && evaluated == 4);
+		assert(from(zs).select(traced).average(summation::pairwise) == 1073741824.0 && evaluated == 6);
+	}
 	//////////////////////////////////////////////////////////////////
 	// set
 	//////////////////////////////////////////////////////////////////
@@ -195,6 +531,88 @@ void test()
 		assert(from(xs).except(ys).sequence_equal({ 1 }));
 		assert(from(xs).intersect(ys).sequence_equal({ 2, 3 }));
 		assert(from(xs).linq_union(ys).sequence_equal({ 1, 2, 3, 4 }));
+
+		std::vector<int> big, other;
+		for (int i = 0; i < 60000; i++)
+		{
+			big.push_back((i * 7919) % 20000);
+			other.push_back((i * 7877) % 30000 + 10000);
+		}
+		memory_budget small{ 1000 * sizeof(int) };
+		assert(from(xs).distinct(small).sequence_equal({ 1, 2, 3 }));
+		assert(from(xs).except(ys, small).sequence_equal({ 1 }));
+		assert(from(xs).intersect(ys, small).sequence_equal({ 2, 3 }));
+		assert(from(big).distinct(small).sequence_equal(from(big).distinct()));
+		assert(from(big).except(other, small).sequence_equal(from(big).except(other)));
+		assert(from(other).except(big, small).sequence_equal(from(other).except(big)));
+		assert(from(big).intersect(other, small).sequence_equal(from(big).intersect(other)));
+		auto seen = [](int x){return x % 3 != 0; };
+		auto spilled_distinct = from(big).distinct(small).where(seen);
+		size_t distinct_count = from(big).distinct().where(seen).count();
+		assert(spilled_distinct.count() == distinct_count && spilled_distinct.count() == distinct_count);
+		auto spilled_except = from(other).except(big, small).where(seen);
+		assert(spilled_except.count() == spilled_except.count() && spilled_except.sequence_equal(from(other).except(big).where(seen)));
+		auto spilled_intersect = from(big).intersect(other, small).skip_while([](int x){return x < 15000; });
+		assert(spilled_intersect.count() == spilled_intersect.count() && spilled_intersect.sequence_equal(from(big).intersect(other).skip_while([](int x){return x < 15000; })));
+		std::vector<std::string> words = { "b", "a", "b", "c", "a" };
+		assert(from(words).distinct(memory_budget{ 1 }).sequence_equal({ "a", "b", "c" }));
+
+		bloom_filter_statistics statistics;
+		bloom_filter_options filtered;
+		filtered.statistics = &statistics;
+		assert(from(xs).except(ys, filtered).sequence_equal({ 1 }));
+		assert(statistics.probes == 6 && statistics.matches == 4);
+		assert(from(xs).intersect(ys, filtered).sequence_equal({ 2, 3 }));
+		assert(from(big).except(other, filtered).sequence_equal(from(big).except(other)));
+		assert(from(big).intersect(other, filtered).sequence_equal(from(big).intersect(other)));
+		assert(statistics.probes == big.size() && statistics.matches == from(big).where([](int x){return x >= 10000; }).count());
+		assert(statistics.false_positive_rate() < 0.05);
+		filtered.bits_per_key = 0.01;
+		assert(from(big).intersect(other, filtered).sequence_equal(from(big).intersect(other)));
+		assert(statistics.rejected == 0 && statistics.false_positive_rate() == 1.0);
+		std::vector<compared> probes, excluded;
+		for (int i = 0; i < 100000; i++) probes.push_back(compared{ i * 2 });
+		for (int i = 0; i < 1000; i++) excluded.push_back(compared{ i * 2 + 1 });
+		compared::comparisons = 0;
+		size_t kept = from(probes).except(excluded).count();
+		size_t plain_comparisons = compared::comparisons;
+		compared::comparisons = 0;
+		assert(from(probes).except(excluded, bloom_filter_options()).count() == kept && kept == probes.size());
+		assert(compared::comparisons * 10 < plain_comparisons);
+		std::vector<std::string> letters = { "a", "c" };
+		assert(from(words).except(letters, bloom_filter_options()).sequence_equal({ "b" }));
+
+		assert(from(xs).as_sorted().distinct().sequence_equal({ 1, 2, 3 }));
+		assert(from(xs).as_sorted().except(ys).sequence_equal({ 1 }));
+		assert(from(xs).as_sorted().intersect(ys).sequence_equal({ 2, 3 }));
+		assert(from(xs).as_sorted().linq_union(ys).sequence_equal({ 1, 2, 3, 4 }));
+		assert(from(ys).as_sorted().except(xs).sequence_equal({ 4 }));
+		assert(from(xs).as_sorted().distinct(small).sequence_equal({ 1, 2, 3 }));
+		assert(from(xs).as_sorted().intersect(ys, small).sequence_equal({ 2, 3 }));
+		assert(from(xs).as_sorted().contains(2) && !from(xs).as_sorted().contains(0) && !from(xs).as_sorted().contains(4));
+		assert(from(xs).as_sorted().equal_range(2).count() == 2 && from(xs).as_sorted().equal_range(5).count() == 0);
+		assert(from(xs).as_sorted().range(2, 4).sequence_equal({ 2, 2, 3, 3 }));
+		assert(from(xs).as_sorted().range(3, 2).count() == 0);
+
+		std::vector<int> sorted_big = from(big).order_by([](int x){return x; }).to_vector();
+		std::vector<int> sorted_other = from(other).order_by([](int x){return x; }).to_vector();
+		assert(from(sorted_big).as_sorted().distinct().sequence_equal(from(big).distinct()));
+		assert(from(sorted_big).as_sorted().except(sorted_other).sequence_equal(from(sorted_big).except(other)));
+		assert(from(sorted_other).as_sorted().except(sorted_big).sequence_equal(from(sorted_other).except(big)));
+		assert(from(sorted_big).as_sorted().intersect(sorted_other).sequence_equal(from(big).intersect(other)));
+		assert(from(sorted_big).as_sorted().linq_union(sorted_other).sequence_equal(from(big).linq_union(other)));
+		assert(from(sorted_big).as_sorted().distinct().intersect(from(sorted_other).as_sorted().distinct()).sequence_equal(from(big).intersect(other)));
+
+		std::set<int> evens = { 0, 2, 4, 6, 8 };
+		std::list<int> odds = { 1, 3, 5, 7 };
+		assert(from(evens).as_sorted().linq_union(odds).sequence_equal({ 0, 1, 2, 3, 4, 5, 6, 7, 8 }));
+		assert(from(odds).as_sorted().contains(5) && !from(odds).as_sorted().contains(4));
+		assert(from(odds).as_sorted().range(2, 6).sequence_equal({ 3, 5 }));
+		auto descending = [](int a, int b){return a > b; };
+		int zs[] = { 9, 7, 7, 4, 1 };
+		assert(from(zs).assume_sorted(descending).distinct().sequence_equal({ 9, 7, 4, 1 }));
+		assert(from(zs).assume_sorted(descending).contains(4) && !from(zs).assume_sorted(descending).contains(5));
+		assert(from(zs).where([](int x){return x != 4; }).assume_sorted(descending).except(std::vector<int>{ 9 }).sequence_equal({ 7, 1 }));
 	}
 	//////////////////////////////////////////////////////////////////
 	// restructuring
@@ -209,6 +627,36 @@ void test()
 		auto g = from(xs).group_by([](int x){return x % 2; });
 		assert(from(g[0]).sequence_equal({ 2, 4 }));
 		assert(from(g[1]).sequence_equal({ 1, 3, 5 }));
+		assert(from(xs).group_by(execution::par, [](int x){return x % 2; }) == g);
+		typedef std::vector<std::pair<int, int>> TSums;
+		assert(from(xs).group_aggregate([](int x){return x % 2; }, sum_of()) == TSums({ { 0, 6 }, { 1, 9 } }));
+
+		std::vector<int> big(100000);
+		for (int i = 0; i < 100000; i++) big[i] = (i * 7919) % 100000;
+		auto bucket = [](int x){return x % 1000; };
+		auto half = [](int x){return x / 2; };
+		auto serial_groups = from(big).group_by(bucket, half);
+		auto parallel_groups = from(big).group_by(execution::par.with_concurrency(4), bucket, half);
+		assert(parallel_groups.size() == 1000 && parallel_groups == serial_groups);
+		assert(from(big).group_by(execution::par.with_concurrency(3), [](int x){return x % 7 == 0; }) == from(big).group_by([](int x){return x % 7 == 0; }));
+		auto serial_counts = from(big).group_aggregate(bucket, count_of());
+		auto parallel_counts = from(big).group_aggregate(execution::par.with_concurrency(4), bucket, count_of());
+		assert(serial_counts == parallel_counts && serial_counts.size() == 1000 && serial_counts[0].second == 100);
+		auto parallel_sums = from(big).group_aggregate(execution::par, [](int x){return x % 3; }, sum_of([](int x){return static_cast<long long>(x); }));
+		assert(parallel_sums.size() == 3 && parallel_sums[0].first == 0);
+		//keys with a common stride still spread over every partition
+		std::vector<size_t> strided(8);
+		for (size_t key = 0; key < 8000; key++) strided[parallel::partition_of(key * 1024, 8)]++;
+		assert(from(strided).min() > 800);
+		auto stride = [](int x){return x / 1000 * 1024; };
+		assert(from(big).group_aggregate(execution::par.with_concurrency(8), stride, count_of()) == from(big).group_aggregate(stride, count_of()));
+		assert(from(big).group_by(execution::par.with_concurrency(8), stride) == from(big).group_by(stride));
+		assert(from(parallel_sums).select([](const std::pair<int, long long>& p){return p.second; }).sum() == 4999950000LL);
+		assert(from(big).group_by(bucket, half, memory_budget{ 4096 }).sequence_equal(serial_groups));
+		assert(from(big).group_by(bucket, memory_budget{ 1 << 30 }).sequence_equal(from(big).group_by(bucket)));
+		assert(from(xs).group_by([](int x){return x % 2; }, memory_budget{ 1 }).sequence_equal(g));
+		auto late_groups = from(big).group_by(bucket, memory_budget{ 4096 }).skip_while([](const auto& group){return group.front() % 1000 < 990; });
+		assert(late_groups.count() == 10 && late_groups.count() == 10);
 
         assert(
             from({ 1, 2, 3 })
@@ -221,6 +669,108 @@ void test()
             .select_many([](int x){return from_values({x, x*x, x*x*x});})
             .sequence_equal({ 1, 1, 1, 2, 4, 8, 3, 9, 27 })
         );
+		assert(from({ 1, 2, 3 }).select_many(execution::par, [](int x){return from_values({x, x*x});}).sequence_equal({ 1, 1, 2, 4, 3, 9 }));
+
+		std::vector<std::vector<int>> owners(2000);
+		for (int i = 0; i < 2000; i++) owners[i].assign(i % 97 == 0 ? 20000 : i % 3, 2000 - i);
+		std::vector<int> flat;
+		for (auto& pets : owners) flat.insert(flat.end(), pets.begin(), pets.end());
+		auto same = [](const std::vector<int>& pets){return pets; };
+		assert(from(owners).select_many(execution::par, same).sequence_equal(flat));
+		assert(from(owners).select_many(execution::par.with_concurrency(3), same).sequence_equal(flat));
+		std::atomic<int> active(0), peak(0);
+		assert(from(owners).select_many(execution::par.with_concurrency(2), [&](const std::vector<int>& pets)
+		{
+			int now = ++active;
+			for (int seen = peak; now > seen && !peak.compare_exchange_weak(seen, now);) {}
+			std::this_thread::sleep_for(std::chrono::microseconds(pets.size() > 100 ? 200 : 0));
+			--active;
+			return pets;
+		}).sequence_equal(flat));
+		assert(peak <= 2);
+		auto sorted_pets = from(owners).select_many(execution::par, [](const std::vector<int>& pets)
+		{
+			std::vector<int> both(pets);
+			for (int x : pets) both.push_back(-x);
+			return from(both).order_by(execution::par, [](int x){return x; }).to_vector();
+		});
+		assert(sorted_pets.count() == 2 * flat.size() && sorted_pets.select([](int x){return x > 0 ? x : -x; }).sum() == 2 * from(flat).sum());
+
+		std::atomic<int> done(0);
+		parallel::task_group group;
+		for (int i = 0; i < 100; i++) group.run([&done]{ ++done; });
+		group.wait();
+		assert(done == 100);
+		parallel::thread_pool pool(2);
+		assert(pool.size() == 2);
+		parallel::task_group own(pool);
+		own.run([]{ throw linq_exception("task"); });
+		own.run([&own]{ own.run([]{}); });
+		try{ own.wait(); assert(false); }
+		catch (const linq_exception&){}
+		try{ parallel::set_default_pool_size(2); assert(false); }
+		catch (const linq_exception&){}
+	}
+	//////////////////////////////////////////////////////////////////
+	// columns
+	//////////////////////////////////////////////////////////////////
+	{
+		std::vector<int> ids = { 1, 2, 3, 4 };
+		std::vector<double> scores = { 0.5, 0.9, 0.1, 0.7 };
+		std::string names[] = { "a", "b", "c", "d" };
+		auto rows = from_columns(ids, scores, names);
+		typedef column_row<int, double, std::string> TRow;
+
+		assert(rows.count() == 4);
+		assert(rows.where([](const TRow& row){return row.get<1>() > 0.6; }).select([](const TRow& row){return get<0>(row); }).sequence_equal({ 2, 4 }));
+		assert(rows.where([](const TRow& row){return get<0>(row) % 2 == 1; }).select(column<2>()).sequence_equal({ "a", "c" }));
+		assert(rows.select(column<0>()).sum() == 10);
+		static_assert(std::is_same<decltype(rows.select(column<1>())), Queryable<const double*>>::value, "column projection");
+		assert(rows.skip(2).select(column<2>()).sequence_equal({ "c", "d" }));
+		assert(rows.zip(names).all([](const std::pair<TRow, std::string>& p){return p.first.get<2>() == p.second; }));
+		assert(from(ids).zip(rows).select([](const std::pair<int, TRow>& p){return p.first * p.second.get<1>(); }).sum() > 5.0);
+		try{ from_columns(ids, std::vector<double>(3)); assert(false); }
+		catch (const linq_exception&){}
+	}
+	//////////////////////////////////////////////////////////////////
+	// batching
+	//////////////////////////////////////////////////////////////////
+	{
+		int xs[] = { 1, 2, 3, 4, 5 };
+		std::list<int> ys = { 1, 2, 3, 4, 5 };
+		auto sum = [](const Queryable<const int*>& q){return q.sum(); };
+
+		assert(from(xs).chunk(2).count() == 3);
+		assert(from(xs).chunk(2).select([](Queryable<const int*> q){return q.sum(); }).sequence_equal({ 3, 7, 5 }));
+		assert(from(ys).chunk(2).select(sum).sequence_equal({ 3, 7, 5 }));
+		assert(from(xs).where([](int x){return x != 3; }).chunk(3).select(sum).sequence_equal({ 7, 5 }));
+		assert(from(xs).chunk(5).select(sum).sequence_equal({ 15 }));
+		assert(from(ys).take(0).chunk(2).empty());
+
+		assert(from(xs).sliding_window(3).select([](Queryable<const int*> q){return q.sum(); }).sequence_equal({ 6, 9, 12 }));
+		assert(from(ys).sliding_window(3).select(sum).sequence_equal({ 6, 9, 12 }));
+		assert(from(xs).sliding_window(2, 2).select([](Queryable<const int*> q){return q.sum(); }).sequence_equal({ 3, 7 }));
+		assert(from(ys).sliding_window(2, 3).select(sum).sequence_equal({ 3, 9 }));
+		assert(from(ys).sliding_window(6).empty());
+
+		int zs[] = { 1, 2, 4, 5, 6, 9 };
+		std::list<int> ws(std::begin(zs), std::end(zs));
+		auto adjacent = [](int a, int b){return b == a + 1; };
+		assert(from(zs).chunk_by(adjacent).select([](Queryable<const int*> q){return q.count(); }).sequence_equal({ 2u, 3u, 1u }));
+		assert(from(ws).chunk_by(adjacent).select([](Queryable<const int*> q){return q.count(); }).sequence_equal({ 2u, 3u, 1u }));
+		try{ from(xs).chunk(0); assert(false); }
+		catch (const linq_exception&){}
+
+		std::vector<std::pair<int, int>> logs = { { 1, 10 }, { 1, 20 }, { 2, 5 }, { 3, 1 }, { 3, 2 }, { 3, 3 }, { 1, 7 } };
+		std::list<std::pair<int, int>> stream(logs.begin(), logs.end());
+		auto hour = [](const std::pair<int, int>& p){return p.first; };
+		auto value = [](const std::pair<int, int>& p){return p.second; };
+		assert(from(logs).group_adjacent(hour).count() == 4);
+		assert(from(logs).group_adjacent(hour).select([](const std::pair<int, Queryable<std::vector<std::pair<int, int>>::const_iterator>>& g){return g.first; }).sequence_equal({ 1, 2, 3, 1 }));
+		assert(from(logs).group_adjacent(hour).select([&](const std::pair<int, Queryable<std::vector<std::pair<int, int>>::const_iterator>>& g){return g.second.select(value).sum(); }).sequence_equal({ 30, 5, 6, 7 }));
+		assert(from(stream).group_adjacent(hour).select([&](const std::pair<int, Queryable<const std::pair<int, int>*>>& g){return g.second.select(value).sum(); }).sequence_equal({ 30, 5, 6, 7 }));
+		assert((*from(logs).group_adjacent(hour).begin()).second.begin() == logs.begin());
+		assert(from(stream).take(0).group_adjacent(hour).empty());
 	}
 	//////////////////////////////////////////////////////////////////
 	// ordering
@@ -228,32 +778,136 @@ void test()
 	{
         int xs[] = { 7, 1, 12, 2, 8, 3, 11, 4, 9, 5, 13, 6, 10 };
         int ys[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13 };
-        int zs[] = { 10, 1, 11, 2, 12, 3, 13, 4, 5, 6, 7, 8, 9 };
+        int zs[] = { 1, 2, 3, 4, 5, 7, 6, 8, 9, 11, 10, 12, 13 };
 
         assert(from(xs).order_by([](int x){return x; }).sequence_equal(ys));
         assert(from(xs)
                 .order_by([](int x){return x / 2; })
                 .sequence_equal(zs)
               );
+        assert(from(xs).order_by_descending([](int x){return x; }).sequence_equal(from(ys).order_by_descending([](int x){return x; })));
+        assert(from(xs).order_by_descending([](int x){return x; }).first() == 13);
+        assert(from(xs)
+                .order_by([](int x){return x % 2; })
+                .then_by_descending([](int x){return x; })
+                .sequence_equal({ 12, 10, 8, 6, 4, 2, 13, 11, 9, 7, 5, 3, 1 })
+              );
+
+        assert(from(xs).order_by([](int x){return x; }).take(3).sequence_equal({ 1, 2, 3 }));
+        assert(from(xs).order_by([](int x){return x; }).take(0).empty());
+        assert(from(xs).order_by([](int x){return x; }).take(20).sequence_equal(ys));
+        assert(from(xs).order_by([](int x){return x / 2; }).take(7).sequence_equal({ 1, 2, 3, 4, 5, 7, 6 }));
+        assert(from(xs).order_by([](int x){return x / 2; }).then_by_descending([](int x){return x; }).take(3).sequence_equal({ 1, 3, 2 }));
+        assert(from(xs).order_by([](int x){return x / 2; }).first() == 1);
+        assert(from(xs).order_by_descending([](int x){return x / 2; }).first() == 12);
+        assert(from(xs).order_by([](int x){return x / 2; }).first([](int x){return x > 4; }) == 5);
+        assert(from(xs).order_by_descending([](int x){return x; }).then_by([](int x){return x; }).first([](int x){return x % 5 == 0; }) == 10);
+        assert(from(xs).top_k(3, [](int x){return x; }).sequence_equal({ 13, 12, 11 }));
+        assert(from(xs).top_k(2, [](int x){return x % 5; }).sequence_equal({ 4, 9 }));
+        assert(from(xs).min_by([](int x){return x % 5; }) == 5);
+        assert(from(xs).max_by([](int x){return x % 5; }) == 4);
+        try{ from(std::vector<int>()).max_by([](int x){return x; }); assert(false); }
+        catch (const linq_exception&){}
+
+        auto q = from(xs).order_by([](int x){return x; });
+        assert(q.count() == 13 && q.sequence_equal(ys));
+
+        std::vector<std::pair<int, int>> big;
+        for (int i = 0; i < 100000; ++i)
+        {
+            big.push_back(std::make_pair((i * 7919) % 1000, i));
+        }
+        auto key = [](const std::pair<int, int>& p){return p.first; };
+        auto index = [](const std::pair<int, int>& p){return p.second % 3; };
+        auto serial = from(big).order_by(key).then_by(index).to_vector();
+        assert(from(big).order_by(execution::par, key).then_by(index).sequence_equal(serial));
+        assert(from(big).order_by(execution::par.with_concurrency(3), key).then_by(index).sequence_equal(serial));
+        assert(from(serial).skip(1).zip(from(serial).take(99999)).all([](const std::pair<std::pair<int, int>, std::pair<int, int>>& p)
+        {
+            auto& next = p.first;
+            auto& prev = p.second;
+            return prev.first < next.first || (prev.first == next.first && (prev.second % 3 < next.second % 3 || (prev.second % 3 == next.second % 3 && prev.second < next.second)));
+        }));
+
+        auto spilled = from(big).order_by(key, memory_budget{ 4096 * sizeof(std::pair<int, int>) });
+        assert(spilled.sequence_equal(from(big).order_by(key)));
+        assert(spilled.sequence_equal(from(big).order_by(key)));
+        auto even = [](const std::pair<int, int>& p){return p.second % 2 == 0; };
+        auto filtered = spilled.where(even);
+        size_t evens = from(big).where(even).count();
+        assert(filtered.count() == evens && filtered.count() == evens && filtered.to_vector().size() == evens);
+        auto late = spilled.skip_while([](const std::pair<int, int>& p){return p.first < 5; });
+        assert(late.count() == late.count() && late.sequence_equal(from(big).order_by(key).skip_while([](const std::pair<int, int>& p){return p.first < 5; })));
+        auto cursor = spilled.begin();
+        auto copy = cursor;
+        ++cursor;
+        assert(*copy == *spilled.begin() && *cursor == *++spilled.begin() && copy != cursor && ++copy == cursor);
+        assert(from(big).order_by_descending(key, memory_budget{ 1 << 20 }).take(3).sequence_equal(from(big).order_by_descending(key).take(3)));
+        assert(from(xs).order_by([](int x){return x; }, memory_budget{ 3 * sizeof(int) }).sequence_equal(ys));
+        assert(from(std::vector<int>()).order_by([](int x){return x; }, memory_budget{ 16 }).empty());
+        std::vector<std::string> words = { "pear", "fig", "apple", "kiwi", "banana", "date" };
+        assert(from(words).order_by([](const std::string& s){return s.size(); }, memory_budget{ 2 * sizeof(std::string) })
+            .sequence_equal({ "fig", "pear", "kiwi", "date", "apple", "banana" }));
+        try{ from(xs).order_by([](int x){return x; }, memory_budget{ 1, "/nonexistent-cpplinq-dir" }).to_vector(); assert(false); }
+        catch (const linq_exception&){}
+	}
+	//////////////////////////////////////////////////////////////////
+	// standard library
+	//////////////////////////////////////////////////////////////////
+	{
+		std::vector<int> xs = { 5, 3, 8, 1, 9, 2 };
+		int limit = 4;
+		auto big = from(xs).where([limit](int x){return x > limit; });
+		typedef decltype(big.begin()) TIter;
+		static_assert(std::is_same<std::iterator_traits<TIter>::value_type, int>::value, "iterator traits");
+		static_assert(std::is_copy_assignable<TIter>::value && std::is_default_constructible<TIter>::value, "stateful predicates are boxed");
+		auto it = big.begin();
+		it = big.end();
+		assert(it == big.end());
+		assert(std::count_if(big.begin(), big.end(), [](int x){return x % 2 == 1; }) == 2);
+		assert(std::vector<int>(big.begin(), big.end()) == std::vector<int>({ 5, 8, 9 }));
+		assert(std::accumulate(big.begin(), big.end(), 0) == 22);
+
+		assert((from(xs) | views::where([](int x){return x > 2; }) | views::select([](int x){return x * 10; }) | views::take(2)).sequence_equal({ 50, 30 }));
+		assert((xs | views::order_by([](int x){return x; }) | views::take(3)).sequence_equal({ 1, 2, 3 }));
+		assert((xs | views::skip_while([](int x){return x != 1; }) | views::chunk(2)).count() == 2);
+#if __cplusplus >= 201703L
+		assert(std::reduce(big.begin(), big.end()) == 22);
+#endif
+#ifdef __cpp_lib_ranges
+		static_assert(std::ranges::view<decltype(big)>);
+		static_assert(std::forward_iterator<TIter>);
+		static_assert(std::ranges::forward_range<decltype(from(xs).select([](int x){return x * 2; }))>);
+		static_assert(std::ranges::view<decltype(from(xs).order_by([](int x){return x; }))>);
+		assert(std::ranges::count_if(big, [](int x){return x % 2 == 1; }) == 2);
+		auto sorted = big.to_vector();
+		std::ranges::sort(sorted, std::greater<>());
+		assert(sorted == std::vector<int>({ 9, 8, 5 }));
+		assert(std::ranges::equal(big | std::views::transform([](int x){return x * 2; }), std::vector<int>({ 10, 16, 18 })));
+		assert(from(xs | std::views::filter([](int x){return x < 4; }) | std::views::transform([](int x){return x + 1; })).sequence_equal({ 4, 2, 3 }));
+		assert(from(std::views::iota(1, 5)).sum() == 10);
+		assert(from(std::vector<int>({ 1, 2, 3 })).select([](int x){return x * x; }).sum() == 14);
+		assert((std::views::iota(1, 7) | views::where([](int x){return x % 2 == 0; })).sum() == 12);
+#endif
 	}
 	//////////////////////////////////////////////////////////////////
 	// joining
 	//////////////////////////////////////////////////////////////////
 	{
-        //person magnus = { "Hedlund, Magnus" };
-        //person terry = { "Adams, Terry" };
-        //person charlotte = { "Weiss, Charlotte" };
-        //person persons[] = { magnus, terry, charlotte };
+        person magnus = { "Hedlund, Magnus" };
+        person terry = { "Adams, Terry" };
+        person charlotte = { "Weiss, Charlotte" };
+        person persons[] = { magnus, terry, charlotte };
 
-        //pet barley = { "Barley", terry };
-        //pet boots = { "Boots", terry };
-        //pet whiskers = { "Whiskers", charlotte };
-        //pet daisy = { "Daisy", magnus };
-        //pet pets[] = { barley, boots, whiskers, daisy };
+        pet barley = { "Barley", terry };
+        pet boots = { "Boots", terry };
+        pet whiskers = { "Whiskers", charlotte };
+        pet daisy = { "Daisy", magnus };
+        pet pets[] = { barley, boots, whiskers, daisy };
 
-        //auto person_name = [](const person& p){return p.name; };
-        //auto pet_name = [](const pet& p){return p.name; };
-        //auto pet_owner_name = [](const pet& p){return p.owner.name; };
+        auto person_name = [](const person& p){return p.name; };
+        auto pet_name = [](const pet& p){return p.name; };
+        auto pet_owner_name = [](const pet& p){return p.owner.name; };
 
         //auto f = from(persons).full_join(from(pets), person_name, pet_owner_name);
         //{
@@ -267,32 +921,101 @@ void test()
             //assert(xs[1].second.second.select(pet_name).sequence_equal({ daisy.name }));
             //assert(xs[2].second.second.select(pet_name).sequence_equal({ whiskers.name }));
         //}
-        //auto g = from(persons).group_join(from(pets), person_name, pet_owner_name);
-        //{
-            //typedef join_pair<string, person, linq<pet>> TItem;
-            //auto xs = g.to_vector();
-            //assert(from(xs).select([](const TItem& item){return item.first; }).sequence_equal({ terry.name, magnus.name, charlotte.name }));
-            //assert(xs[0].second.first.name == terry.name);
-            //assert(xs[1].second.first.name == magnus.name);
-            //assert(xs[2].second.first.name == charlotte.name);
-            //assert(xs[0].second.second.select(pet_name).sequence_equal({ barley.name, boots.name }));
-            //assert(xs[1].second.second.select(pet_name).sequence_equal({ daisy.name }));
-            //assert(xs[2].second.second.select(pet_name).sequence_equal({ whiskers.name }));
-        //}
-        //auto j = from(persons).join(from(pets), person_name, pet_owner_name);
-        //{
-            //typedef join_pair<string, person, pet> TItem;
-            //auto xs = j.to_vector();
-            //assert(from(xs).select([](const TItem& item){return item.first; }).sequence_equal({ terry.name, terry.name, magnus.name, charlotte.name }));
-            //assert(xs[0].second.first.name == terry.name);
-            //assert(xs[1].second.first.name == terry.name);
-            //assert(xs[2].second.first.name == magnus.name);
-            //assert(xs[3].second.first.name == charlotte.name);
-            //assert(xs[0].second.second.name == barley.name);
-            //assert(xs[1].second.second.name == boots.name);
-            //assert(xs[2].second.second.name == daisy.name);
-            //assert(xs[3].second.second.name == whiskers.name);
+        auto g = from(persons).group_join(from(pets), person_name, pet_owner_name);
+        {
+            typedef join_pair<std::string, person, linq<pet>> TItem;
+            auto xs = g.to_vector();
+            assert(from(xs).select([](const TItem& item){return item.first; }).sequence_equal({ terry.name, magnus.name, charlotte.name }));
+            assert(xs[0].second.first.name == terry.name);
+            assert(xs[1].second.first.name == magnus.name);
+            assert(xs[2].second.first.name == charlotte.name);
+            assert(xs[0].second.second.select(pet_name).sequence_equal({ barley.name, boots.name }));
+            assert(xs[1].second.second.select(pet_name).sequence_equal({ daisy.name }));
+            assert(xs[2].second.second.select(pet_name).sequence_equal({ whiskers.name }));
+        }
+        auto j = from(persons).join(from(pets), person_name, pet_owner_name);
+        {
+            typedef join_pair<std::string, person, pet> TItem;
+            auto xs = j.to_vector();
+            assert(from(xs).select([](const TItem& item){return item.first; }).sequence_equal({ terry.name, terry.name, magnus.name, charlotte.name }));
+            assert(xs[0].second.first.name == terry.name);
+            assert(xs[1].second.first.name == terry.name);
+            assert(xs[2].second.first.name == magnus.name);
+            assert(xs[3].second.first.name == charlotte.name);
+            assert(xs[0].second.second.name == barley.name);
+            assert(xs[1].second.second.name == boots.name);
+            assert(xs[2].second.second.name == daisy.name);
+            assert(xs[3].second.second.name == whiskers.name);
+        }
+        auto same_join = [](const join_pair<std::string, person, pet>& a, const join_pair<std::string, person, pet>& b)
+        {
+            return a.first == b.first && a.second.first.name == b.second.first.name && a.second.second.name == b.second.second.name;
+        };
+        assert(from(persons).join(execution::par.ordered(), pets, person_name, pet_owner_name).to_vector().size() == 4);
+        auto pj = from(persons).join(execution::par.ordered(), pets, person_name, pet_owner_name).to_vector();
+        assert(std::equal(pj.begin(), pj.end(), j.begin(), same_join));
+        auto pg = from(persons).group_join(execution::par.ordered(), pets, person_name, pet_owner_name).to_vector();
+        assert(from(pg).select([](const join_pair<std::string, person, linq<pet>>& item){return item.second.second.count(); }).sequence_equal({ 2u, 1u, 1u }));
+        assert(from(persons).group_join(pets, person_name, [](const pet&){return std::string(); }).all([](const join_pair<std::string, person, linq<pet>>& item){return item.second.second.empty(); }));
+
+        std::vector<int> orders(200000), customers(50000);
+        for (int i = 0; i < 200000; i++) orders[i] = (i * 7919) % 60000;
+        for (int i = 0; i < 50000; i++) customers[i] = i;
+        auto id = [](int x){return x; };
+        auto serial = from(orders).join(customers, id, id).to_vector();
+        auto ordered = from(orders).join(execution::par.with_concurrency(4).ordered(), customers, id, id).to_vector();
+        auto unordered = from(orders).join(execution::par.with_concurrency(4), customers, id, id).to_vector();
+        assert(serial.size() == from(orders).where([](int x){return x < 50000; }).count());
+        assert(ordered == serial);
+        std::sort(unordered.begin(), unordered.end());
+        auto sorted = serial;
+        std::sort(sorted.begin(), sorted.end());
+        assert(unordered == sorted);
+        auto groups = from(customers).group_join(execution::par.with_concurrency(4).ordered(), orders, id, id);
+        assert(groups.count() == 50000);
+        assert(groups.select([](const join_pair<int, int, linq<int>>& g){return g.second.second.count(); }).sum() == serial.size());
+        assert(groups.all([](const join_pair<int, int, linq<int>>& g){return g.first == g.second.first; }));
+        bloom_filter_statistics joined;
+        bloom_filter_options filtered;
+        filtered.statistics = &joined;
+        auto few = from(customers).take(1000).to_vector();
+        assert(from(few).join(orders, id, id, filtered).to_vector() == from(few).join(orders, id, id).to_vector());
+        assert(joined.probes == orders.size() && joined.matches == from(orders).where([](int x){return x < 1000; }).count());
+        assert(joined.rejected > (joined.probes - joined.matches) * 9 / 10 && joined.false_positive_rate() < 0.05);
+        assert(from(persons).join(pets, person_name, pet_owner_name, bloom_filter_options()).to_vector().size() == 4);
     }
+#if defined(__linux__)
+	//////////////////////////////////////////////////////////////////
+	// processes
+	//////////////////////////////////////////////////////////////////
+	{
+		std::vector<long long> rows(100000);
+		for (int i = 0; i < 100000; i++) rows[i] = (i * 7919LL) % 100003;
+		std::string path = spill::temp_directory(memory_budget{ 0 }) + "/cpplinq-processes.bin";
+		from(rows).to_file(path);
+		mapped_file<long long> file(path);
+		assert(file.size() == rows.size() && from(file).sequence_equal(rows));
+		mapped_file<long long> unmapped;
+		assert(unmapped.size() == 0 && unmapped.begin() == unmapped.end() && from(unmapped).empty());
+
+		processes::executor workers(4);
+		auto plus = [](long long a, long long b){return a + b; };
+		assert(workers.aggregate(from(file), [](const Queryable<const long long*>& part){return part.sum(); }, plus) == from(rows).sum());
+		auto even = [](long long x){return x % 2 == 0; };
+		assert(workers.collect(from(rows), [&](const Queryable<std::vector<long long>::const_iterator>& part){return part.where(even).to_vector(); })
+			== from(rows).where(even).to_vector());
+		auto digit = [](long long x){return x % 10; };
+		assert(workers.merge_sorted(from(file), [&](const Queryable<const long long*>& part){return part.order_by(digit).to_vector(); },
+			[&](long long a, long long b){return digit(a) < digit(b); }) == from(rows).order_by(digit).to_vector());
+		assert(workers.merge_groups(from(file), [&](const Queryable<const long long*>& part){return part.group_aggregate(digit, count_of()); }, plus)
+			== from(rows).group_aggregate(digit, count_of()));
+		std::vector<std::string> names = { "a", "bb", "ccc" };
+		assert(processes::executor(8).collect(from(names), [](const Queryable<std::vector<std::string>::const_iterator>& part){return part.to_vector(); }) == names);
+		try{ workers.map(from(file), [](const Queryable<const long long*>&) -> int { throw linq_exception("worker"); }); assert(false); }
+		catch (const linq_exception&){}
+		std::remove(path.c_str());
+	}
+#endif
 
     // calculate sum of squares of odd numbers
     {